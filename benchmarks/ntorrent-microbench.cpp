@@ -0,0 +1,355 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "../scenarios/simulation-common.hpp"
+#include "../extensions/ntorrent-torrent-generator.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+/**
+ * Microbenchmarks for the per-packet paths of the NTorrent apps and strategy.
+ *
+ * Every operation is timed in isolation on synthetic input (the torrent generated from
+ * DUMMY_FILE_PATH), outside of the event loop, and reported as ns/op and allocs/op:
+ *
+ *     ./build/ntorrent-microbench
+ *     ./build/ntorrent-microbench --iterations=100000 --appIterations=5000
+ *
+ * The app and strategy benchmarks run against a 3 node line (producer - router - consumer)
+ * that has been started for a millisecond, so they include whatever the real code does
+ * after the lookup (handing the Data to NFD, forwarding the Interest out of a face).
+ *
+ * Before timing anything, it checks that generateTorrent (used by the apps) gives exactly the
+ * packets TorrentFile::generate gives.
+ */
+
+// Every allocation in the process goes through here, so allocs/op covers NFD and ns-3 too
+static uint64_t g_allocations = 0;
+
+void*
+operator new(std::size_t size)
+{
+  ++g_allocations;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void
+operator delete(void* p) noexcept
+{
+  std::free(p);
+}
+
+namespace ns3 {
+namespace ndn {
+
+static void
+printResult(std::ostream& report, const std::string& name, uint64_t iterations, double ns, uint64_t allocations)
+{
+  report << std::left << std::setw(40) << name << std::right
+         << std::setw(10) << iterations
+         << std::setw(14) << std::fixed << std::setprecision(1) << ns / iterations
+         << std::setw(14) << std::setprecision(2) << (double)allocations / iterations
+         << std::endl;
+}
+
+template<typename Op>
+void
+measure(std::ostream& report, const std::string& name, uint64_t iterations, Op op)
+{
+  //Warm up caches and lazily built state, on an index the timed loop does not use
+  op(iterations);
+
+  uint64_t allocations = g_allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < iterations; i++)
+    op(i);
+  auto end = std::chrono::steady_clock::now();
+  allocations = g_allocations - allocations;
+
+  printResult(report, name, iterations, std::chrono::duration<double, std::nano>(end - start).count(),
+              allocations);
+}
+
+//For ops that use up their input (a PIT entry, an app's store...): before every batch of
+//batchSize ops, prepare(batch) builds their input, untimed. The first batch is a warm up.
+template<typename Prepare, typename Op>
+void
+measureBatches(std::ostream& report, const std::string& name, uint64_t iterations, uint64_t batchSize,
+               Prepare prepare, Op op)
+{
+  prepare(batchSize);
+  for (uint64_t i = 0; i < batchSize; i++)
+    op(i);
+
+  double ns = 0;
+  uint64_t allocations = 0;
+  for (uint64_t first = 0; first < iterations; first += batchSize) {
+    uint64_t count = std::min(batchSize, iterations - first);
+    prepare(count);
+
+    uint64_t batchAllocations = g_allocations;
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++)
+      op(i);
+    auto end = std::chrono::steady_clock::now();
+    allocations += g_allocations - batchAllocations;
+    ns += std::chrono::duration<double, std::nano>(end - start).count();
+  }
+
+  printResult(report, name, iterations, ns, allocations);
+}
+
+//The apps print received content to std::cout; keep the report readable
+class QuietStdout
+{
+public:
+  QuietStdout()
+    : m_buf(std::cout.rdbuf(nullptr))
+  {
+  }
+
+  ~QuietStdout()
+  {
+    std::cout.rdbuf(m_buf);
+    std::cout.clear();
+  }
+
+private:
+  std::streambuf* m_buf;
+};
+
+//Same packets, in the same order, with the same wire encoding
+static bool
+sameEncoding(const TorrentContent& a, const TorrentContent& b)
+{
+  auto same = [] (const std::vector<Data>& x, const std::vector<Data>& y) {
+    return x.size() == y.size() &&
+           std::equal(x.begin(), x.end(), y.begin(), [] (const Data& p, const Data& q) {
+             return p.wireEncode() == q.wireEncode();
+           });
+  };
+
+  if (!same(std::vector<Data>(a.first.begin(), a.first.end()), std::vector<Data>(b.first.begin(), b.first.end())) ||
+      a.second.size() != b.second.size())
+    return false;
+  for (size_t f = 0; f < a.second.size(); f++) {
+    if (!same(std::vector<Data>(a.second[f].first.begin(), a.second[f].first.end()),
+              std::vector<Data>(b.second[f].first.begin(), b.second[f].first.end())) ||
+        !same(a.second[f].second, b.second[f].second))
+      return false;
+  }
+  return true;
+}
+
+int
+main(int argc, char *argv[])
+{
+  uint32_t namesPerSegment = 2;
+  uint32_t namesPerManifest = 2;
+  uint32_t dataPacketSize = 64;
+  uint64_t iterations = 100000;
+  uint64_t appIterations = 10000;
+  uint64_t generateIterations = 5;
+
+  CommandLine cmd;
+  cmd.AddValue("namesPerSegment", "Number of names per segment", namesPerSegment);
+  cmd.AddValue("namesPerManifest", "Number of names per manifest", namesPerManifest);
+  cmd.AddValue("dataPacketSize", "Data Packet size", dataPacketSize);
+  cmd.AddValue("iterations", "Iterations of the cheap benchmarks (classification, strategy)", iterations);
+  cmd.AddValue("appIterations", "Iterations of the app benchmarks (their stores grow as they run)", appIterations);
+  cmd.AddValue("generateIterations", "Iterations of torrent generation", generateIterations);
+  cmd.Parse(argc, argv);
+
+  //The report keeps going to the terminal while std::cout is silenced
+  std::ostream report(std::cout.rdbuf());
+
+  // Synthetic input: the same torrent the apps generate
+  const auto content = ndn_ntorrent::TorrentFile::generate(ndn_ntorrent::DUMMY_FILE_PATH,
+          namesPerSegment, namesPerManifest, dataPacketSize, true);
+
+  //The apps use the parallel generator; it must produce exactly these packets
+  NS_ABORT_MSG_IF(!sameEncoding(content, generateTorrent(ndn_ntorrent::DUMMY_FILE_PATH,
+          namesPerSegment, namesPerManifest, dataPacketSize, true)),
+          "generateTorrent differs from TorrentFile::generate");
+
+  std::vector<shared_ptr<const Data>> packets;
+  for (const auto& t : content.first)
+    packets.push_back(make_shared<Data>(t));
+  for (const auto& ms : content.second) {
+    for (const auto& m : ms.first)
+      packets.push_back(make_shared<Data>(m));
+    for (const auto& d : ms.second)
+      packets.push_back(make_shared<Data>(d));
+  }
+
+  std::vector<Name> names;
+  for (const auto& p : packets)
+    names.push_back(p->getFullName());
+
+  // producer (0) -- router (1) -- consumer (2)
+  Config::SetDefault("ns3::PointToPointNetDevice::DataRate", StringValue("1Gbps"));
+  Config::SetDefault("ns3::PointToPointChannel::Delay", StringValue("10ms"));
+
+  NodeContainer nodes;
+  nodes.Create(3);
+  PointToPointHelper p2p;
+  createLink(p2p, nodes.Get(0), nodes.Get(1));
+  createLink(p2p, nodes.Get(1), nodes.Get(2));
+
+  StackHelper ndnHelper;
+  ndnHelper.InstallAll();
+  StrategyChoiceHelper::Install<nfd_fw::NTorrentStrategy>(nodes, "/");
+  nfd_fw::NTorrentStrategy::setTraceStream(nullptr);
+
+  GlobalRoutingHelper ndnGlobalRoutingHelper;
+  ndnGlobalRoutingHelper.InstallAll();
+
+  ndn::AppHelper p1("NTorrentProducerApp");
+  createAndInstall(p1, namesPerSegment, namesPerManifest, dataPacketSize, "producer", nodes.Get(0), 0.0f);
+  ndnGlobalRoutingHelper.AddOrigins("/NTORRENT", nodes.Get(0));
+  GlobalRoutingHelper::CalculateRoutes();
+
+  {
+    QuietStdout quiet;
+    Simulator::Stop(MilliSeconds(1));
+    Simulator::Run();
+  }
+
+  Ptr<NTorrentProducerApp> producer = DynamicCast<NTorrentProducerApp>(nodes.Get(0)->GetApplication(0));
+
+  // A consumer only accepts a packet once, so OnData needs a new one for every pass over the
+  // torrent. It walks the torrent from its initial segment (no index), in the order of packets.
+  // The previous one is stopped first, or its timers and adverts would run alongside.
+  Ptr<NTorrentConsumerApp> consumer;
+  auto startConsumer = [&] (uint64_t) {
+      QuietStdout quiet;
+      if (consumer != nullptr)
+        consumer->StopApplication();
+      ndn::AppHelper c1("NTorrentConsumerApp");
+      c1.SetAttribute("TorrentIndex", BooleanValue(false));
+      createAndInstall(c1, namesPerSegment, namesPerManifest, dataPacketSize, "consumer", nodes.Get(2), 0.0f);
+      Simulator::Stop(MilliSeconds(1));
+      Simulator::Run();
+      consumer = DynamicCast<NTorrentConsumerApp>(nodes.Get(2)->GetApplication(nodes.Get(2)->GetNApplications() - 1));
+    };
+
+  Ptr<L3Protocol> l3 = nodes.Get(1)->GetObject<L3Protocol>();
+  shared_ptr<nfd::Forwarder> forwarder = l3->getForwarder();
+  nfd_fw::NTorrentStrategy& strategy = dynamic_cast<nfd_fw::NTorrentStrategy&>(
+          forwarder->getStrategyChoice().findEffectiveStrategy(Name("/")));
+  shared_ptr<nfd::Face> upstream = l3->getFaceByNetDevice(nodes.Get(1)->GetDevice(0));
+  shared_ptr<nfd::Face> downstream = l3->getFaceByNetDevice(nodes.Get(1)->GetDevice(1));
+
+  // Strategy input is built up front, so only the strategy call itself is timed. Interests
+  // carry the torrent's own names (one batch goes through all of them once), and every batch
+  // gets fresh PIT entries: an existing entry would take the retransmission path.
+  std::vector<shared_ptr<Interest>> interests;
+  std::vector<shared_ptr<nfd::pit::Entry>> pitEntries;
+  uint64_t nonce = 0;
+  auto preparePit = [&] (uint64_t count) {
+      for (const auto& pitEntry : pitEntries)
+        forwarder->getPit().erase(pitEntry.get());
+      interests.clear();
+      pitEntries.clear();
+      for (uint64_t i = 0; i < count; i++) {
+        auto interest = make_shared<Interest>(names[i]);
+        interest->setNonce(++nonce);
+        auto pitEntry = forwarder->getPit().insert(*interest).first;
+        pitEntry->insertOrUpdateInRecord(*downstream, *interest);
+        interests.push_back(interest);
+        pitEntries.push_back(pitEntry);
+      }
+    };
+
+  report << std::left << std::setw(40) << "benchmark" << std::right
+         << std::setw(10) << "ops" << std::setw(14) << "ns/op" << std::setw(14) << "allocs/op" << std::endl;
+
+  measure(report, "IoUtil::findType", iterations, [&] (uint64_t i) {
+      ndn_ntorrent::IoUtil::findType(names[i % names.size()]);
+    });
+
+  measure(report, "classifyName", iterations, [&] (uint64_t i) {
+      classifyName(names[i % names.size()]);
+    });
+
+  measureBatches(report, "NTorrentStrategy::afterReceiveInterest", iterations, names.size(), preparePit,
+    [&] (uint64_t i) {
+      strategy.afterReceiveInterest(*downstream, *interests[i], pitEntries[i]);
+    });
+
+  //Data satisfies Interests the strategy has forwarded, as it does in a run
+  measureBatches(report, "NTorrentStrategy::beforeSatisfyInterest", iterations, names.size(),
+    [&] (uint64_t count) {
+      preparePit(count);
+      for (uint64_t i = 0; i < count; i++)
+        strategy.afterReceiveInterest(*downstream, *interests[i], pitEntries[i]);
+    },
+    [&] (uint64_t i) {
+      strategy.beforeSatisfyInterest(pitEntries[i], *upstream, *packets[i]);
+    });
+
+  {
+    QuietStdout quiet;
+    measure(report, "NTorrentProducerApp::OnInterest", appIterations, [&] (uint64_t i) {
+        producer->OnInterest(make_shared<Interest>(names[i % names.size()]));
+      });
+
+    measureBatches(report, "NTorrentConsumerApp::OnData", appIterations, packets.size(), startConsumer,
+      [&] (uint64_t i) {
+        consumer->OnData(packets[i]);
+      });
+
+    //Copies of packets the consumer already holds (multicast forwarding delivers one per upstream)
+    startConsumer(0);
+    for (const auto& packet : packets)
+      consumer->OnData(packet);
+    measure(report, "NTorrentConsumerApp::OnData (duplicate)", appIterations, [&] (uint64_t i) {
+        consumer->OnData(packets[i % packets.size()]);
+      });
+
+    measure(report, "TorrentFile::generate", generateIterations, [&] (uint64_t i) {
+        ndn_ntorrent::TorrentFile::generate(ndn_ntorrent::DUMMY_FILE_PATH,
+                namesPerSegment, namesPerManifest, dataPacketSize, true);
+      });
+    measure(report, "generateTorrent", generateIterations, [&] (uint64_t i) {
+        generateTorrent(ndn_ntorrent::DUMMY_FILE_PATH, namesPerSegment, namesPerManifest, dataPacketSize, true);
+      });
+  }
+
+  Simulator::Destroy();
+
+  return 0;
+}
+
+} // namespace ndn
+} // namespace ns3
+
+int
+main(int argc, char* argv[])
+{
+  return ns3::ndn::main(argc, argv);
+}
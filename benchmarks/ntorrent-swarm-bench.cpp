@@ -0,0 +1,280 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "../scenarios/simulation-common.hpp"
+
+#include "ns3/map-scheduler.h"
+
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+/**
+ * End-to-end throughput benchmark: a fixed swarm (ring of 20 routers with 10 consumers
+ * each, see createRingSwarm) runs through the real producer, consumer and strategy for
+ * 60 simulated seconds. Reported:
+ *
+ *   events        simulator events executed
+ *   events/s      events per wall clock second
+ *   wall/sim-s    wall clock seconds per simulated second
+ *   peak RSS      maximum resident set size of the process
+ *   delivered     bytes of Data received by the consumers
+ *   verified      packets accepted / rejected by the consumers' verification (--verify=0
+ *                 turns it off, to measure what it costs)
+ *   duplicates    copies of already held packets the consumers dropped
+ *
+ * Save a baseline, then compare a later build against it:
+ *
+ *     ./build/ntorrent-swarm-bench --save=master
+ *     ./build/ntorrent-swarm-bench --compare=master
+ *
+ * Baselines are kept in results/<name>.baseline, headed by the command, host and date that
+ * produced them (see results/README.md).
+ */
+
+namespace ns3 {
+namespace ndn {
+
+//Map scheduler that counts the events handed to the simulator
+class CountingScheduler : public MapScheduler
+{
+public:
+  static TypeId
+  GetTypeId(void)
+  {
+    static TypeId tid = TypeId("ns3::ndn::CountingScheduler")
+      .SetParent<MapScheduler>()
+      .AddConstructor<CountingScheduler>();
+    return tid;
+  }
+
+  virtual Scheduler::Event
+  RemoveNext(void)
+  {
+    ++s_events;
+    return MapScheduler::RemoveNext();
+  }
+
+  static uint64_t s_events;
+};
+
+uint64_t CountingScheduler::s_events = 0;
+
+NS_OBJECT_ENSURE_REGISTERED(CountingScheduler);
+
+static uint64_t g_bytesDelivered = 0;
+
+static void
+OnReceivedData(shared_ptr<const Data> data, Ptr<App> app, shared_ptr<Face> face)
+{
+  g_bytesDelivered += data->wireEncode().size();
+}
+
+typedef std::map<std::string, double> Metrics;
+
+//Lines starting with # record how the baseline was produced
+static Metrics
+readBaseline(const std::string& file)
+{
+  Metrics metrics;
+  std::ifstream in(file.c_str());
+  if (!in)
+    NS_FATAL_ERROR("Cannot read baseline " << file << ", record it with --save on the reference build "
+                   "(see results/README.md)");
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    double value;
+    if (line.empty() || line[0] == '#' || !(fields >> key >> value))
+      continue;
+    metrics[key] = value;
+  }
+  return metrics;
+}
+
+static void
+writeBaseline(const std::string& file, const Metrics& metrics, const std::string& commandLine)
+{
+  std::ofstream out(file.c_str());
+  if (!out)
+    NS_FATAL_ERROR("Cannot write baseline " << file);
+
+  char host[256] = "unknown";
+  gethostname(host, sizeof(host) - 1);
+  std::time_t now = std::time(nullptr);
+  char date[64];
+  std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S UTC", std::gmtime(&now));
+  out << "# command: " << commandLine << std::endl;
+  out << "# host: " << host << std::endl;
+  out << "# date: " << date << std::endl;
+
+  for (const auto& m : metrics)
+    out << m.first << " " << std::setprecision(12) << m.second << std::endl;
+}
+
+int
+main(int argc, char *argv[])
+{
+  //The swarm is fixed, so numbers are comparable between builds
+  const uint32_t namesPerSegment = 2;
+  const uint32_t namesPerManifest = 2;
+  const uint32_t dataPacketSize = 64;
+  const uint32_t routers = 20;
+  const uint32_t consumersPerRouter = 10;
+  const double stopTime = 60.0;
+
+  std::string save;
+  std::string compare;
+  std::string resultsDir = "results";
+  bool verify = true;
+
+  CommandLine cmd;
+  cmd.AddValue("save", "Store the results as baseline <name>", save);
+  cmd.AddValue("compare", "Compare the results against baseline <name>", compare);
+  cmd.AddValue("results", "Directory holding the baselines", resultsDir);
+  cmd.AddValue("verify", "Verify received packets against the torrent's digest chain", verify);
+  cmd.Parse(argc, argv);
+
+  std::string commandLine = argv[0];
+  for (int i = 1; i < argc; i++)
+    commandLine += std::string(" ") + argv[i];
+
+  Config::SetDefault("NTorrentConsumerApp::VerifyData", BooleanValue(verify));
+
+  ObjectFactory scheduler;
+  scheduler.SetTypeId("ns3::ndn::CountingScheduler");
+  Simulator::SetScheduler(scheduler);
+
+  auto setupStart = std::chrono::steady_clock::now();
+
+  RingSwarm swarm = createRingSwarm(routers, consumersPerRouter);
+
+  StackHelper ndnHelper;
+  ndnHelper.InstallAll();
+  StrategyChoiceHelper::Install<nfd_fw::NTorrentStrategy>(NodeContainer::GetGlobal(), "/");
+  assignStrategyStreams(NodeContainer::GetGlobal());
+  nfd_fw::NTorrentStrategy::setTraceStream(nullptr);
+
+  GlobalRoutingHelper ndnGlobalRoutingHelper;
+  ndnGlobalRoutingHelper.InstallAll();
+
+  ndn::AppHelper p1("NTorrentProducerApp");
+  createAndInstall(p1, namesPerSegment, namesPerManifest, dataPacketSize, "producer", swarm.producer, 1.0f);
+
+  Ptr<UniformRandomVariable> startTimes = createScenarioRandom();
+  for (uint32_t r = 0; r < routers; r++) {
+    for (uint32_t c = 0; c < consumersPerRouter; c++) {
+      ndn::AppHelper c1("NTorrentConsumerApp");
+      createAndInstall(c1, namesPerSegment, namesPerManifest, dataPacketSize, "consumer",
+              swarm.consumers[r].Get(c), startTimes->GetValue(2.0, 30.0));
+      swarm.consumers[r].Get(c)->GetApplication(0)->TraceConnectWithoutContext("ReceivedDatas",
+              MakeCallback(&OnReceivedData));
+    }
+  }
+
+  ndnGlobalRoutingHelper.AddOrigins("/NTORRENT", swarm.producer);
+  GlobalRoutingHelper::CalculateRoutes();
+
+  Simulator::Stop(Seconds(stopTime));
+
+  //The apps print every received Data; that is not what is being measured
+  std::ostream report(std::cout.rdbuf());
+  std::streambuf* stdoutBuf = std::cout.rdbuf(nullptr);
+
+  auto runStart = std::chrono::steady_clock::now();
+  Simulator::Run();
+  auto runEnd = std::chrono::steady_clock::now();
+
+  std::cout.rdbuf(stdoutBuf);
+  std::cout.clear();
+
+  uint64_t packetsVerified = 0;
+  uint64_t packetsRejected = 0;
+  uint64_t packetsDuplicate = 0;
+  for (const auto& consumers : swarm.consumers) {
+    for (uint32_t c = 0; c < consumers.GetN(); c++) {
+      auto consumer = DynamicCast<NTorrentConsumerApp>(consumers.Get(c)->GetApplication(0));
+      packetsVerified += consumer->getVerifiedPackets();
+      packetsRejected += consumer->getRejectedPackets();
+      packetsDuplicate += consumer->getDuplicatePackets();
+    }
+  }
+
+  Simulator::Destroy();
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  double setupSeconds = std::chrono::duration<double>(runStart - setupStart).count();
+  double wallSeconds = std::chrono::duration<double>(runEnd - runStart).count();
+
+  Metrics metrics;
+  metrics["events"] = CountingScheduler::s_events;
+  metrics["events_per_sec"] = CountingScheduler::s_events / wallSeconds;
+  metrics["setup_sec"] = setupSeconds;
+  metrics["wall_sec"] = wallSeconds;
+  metrics["wall_per_sim_sec"] = wallSeconds / stopTime;
+  metrics["peak_rss_kb"] = usage.ru_maxrss; // kilobytes on Linux
+  metrics["bytes_delivered"] = g_bytesDelivered;
+  metrics["packets_verified"] = packetsVerified;
+  metrics["packets_rejected"] = packetsRejected;
+  metrics["packets_duplicate"] = packetsDuplicate;
+
+  Metrics baseline;
+  if (!compare.empty())
+    baseline = readBaseline(resultsDir + "/" + compare + ".baseline");
+
+  report << std::left << std::setw(20) << "metric" << std::right << std::setw(18) << "value";
+  if (!compare.empty())
+    report << std::setw(18) << compare << std::setw(10) << "delta";
+  report << std::endl;
+
+  for (const auto& m : metrics) {
+    report << std::left << std::setw(20) << m.first << std::right
+           << std::setw(18) << std::fixed << std::setprecision(2) << m.second;
+    auto b = baseline.find(m.first);
+    if (b != baseline.end()) {
+      report << std::setw(18) << b->second;
+      if (b->second != 0)
+        report << std::setw(9) << std::showpos << 100.0 * (m.second - b->second) / b->second
+               << std::noshowpos << "%";
+    }
+    report << std::endl;
+  }
+
+  if (!save.empty())
+    writeBaseline(resultsDir + "/" + save + ".baseline", metrics, commandLine);
+
+  return 0;
+}
+
+} // namespace ndn
+} // namespace ns3
+
+int
+main(int argc, char* argv[])
+{
+  return ns3::ndn::main(argc, argv);
+}
@@ -0,0 +1,147 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-choke-manager.hpp"
+
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <vector>
+
+NS_LOG_COMPONENT_DEFINE("NTorrentChokeManager");
+
+namespace ns3 {
+namespace ndn {
+
+const uint32_t ChokeManager::OPTIMISTIC_ROUNDS;
+
+ChokeManager::ChokeManager()
+  : m_slots(0)
+  , m_reciprocate(true)
+  , m_unchoked(0)
+  , m_optimistic(0)
+  , m_hasOptimistic(false)
+  , m_round(0)
+  , m_chokedRequests(0)
+{
+}
+
+void
+ChokeManager::configure(uint32_t slots, bool reciprocate, Ptr<UniformRandomVariable> rand)
+{
+  m_slots = slots;
+  m_reciprocate = reciprocate;
+  m_rand = rand;
+}
+
+bool
+ChokeManager::allow(uint64_t face)
+{
+  if (m_slots == 0)
+    return true;
+
+  Peer& peer = m_peers[face];
+  peer.interested = true;
+  if (!peer.unchoked && m_unchoked < m_slots) {
+    NS_LOG_DEBUG("Unchoking face " << face << " (free slot)");
+    peer.unchoked = true;
+    m_unchoked++;
+  }
+
+  if (!peer.unchoked)
+    m_chokedRequests++;
+  return peer.unchoked;
+}
+
+void
+ChokeManager::onUpload(uint64_t face, uint64_t bytes)
+{
+  if (m_slots > 0)
+    m_peers[face].uploaded += bytes;
+}
+
+void
+ChokeManager::onDownload(uint64_t face, uint64_t bytes)
+{
+  if (m_slots > 0)
+    m_peers[face].downloaded += bytes;
+}
+
+void
+ChokeManager::rechoke()
+{
+  if (m_slots == 0)
+    return;
+
+  std::vector<uint64_t> interested;
+  for (const auto& peer : m_peers) {
+    if (peer.second.interested)
+      interested.push_back(peer.first);
+  }
+
+  //Best peers first
+  std::stable_sort(interested.begin(), interested.end(), [this] (uint64_t a, uint64_t b) {
+    const Peer& pa = m_peers[a];
+    const Peer& pb = m_peers[b];
+    return m_reciprocate ? pa.downloaded > pb.downloaded : pa.uploaded > pb.uploaded;
+  });
+
+  size_t regular = std::min<size_t>(interested.size(), m_slots - 1);
+
+  //Rotate the optimistic slot, or replace it if its peer lost interest or earned a regular slot
+  bool optimisticValid = m_hasOptimistic &&
+    std::find(interested.begin() + regular, interested.end(), m_optimistic) != interested.end();
+  if ((m_round++ % OPTIMISTIC_ROUNDS == 0 || !optimisticValid) && interested.size() > regular) {
+    m_optimistic = interested[regular + m_rand->GetInteger(0, interested.size() - regular - 1)];
+    m_hasOptimistic = true;
+    NS_LOG_DEBUG("Optimistic unchoke of face " << m_optimistic);
+  }
+  else if (!optimisticValid) {
+    m_hasOptimistic = false;
+  }
+
+  m_unchoked = 0;
+  for (auto& peer : m_peers) {
+    peer.second.unchoked = false;
+  }
+  for (size_t i = 0; i < regular; i++) {
+    m_peers[interested[i]].unchoked = true;
+    m_unchoked++;
+  }
+  if (m_hasOptimistic) {
+    m_peers[m_optimistic].unchoked = true;
+    m_unchoked++;
+  }
+
+  //Rates and interest are measured per period
+  for (auto it = m_peers.begin(); it != m_peers.end(); ) {
+    if (!it->second.unchoked && !it->second.interested && it->second.downloaded == 0) {
+      it = m_peers.erase(it);
+      continue;
+    }
+    it->second.downloaded = 0;
+    it->second.uploaded = 0;
+    it->second.interested = false;
+    ++it;
+  }
+}
+
+} // namespace ndn
+} // namespace ns3
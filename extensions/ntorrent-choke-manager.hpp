@@ -0,0 +1,105 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_CHOKE_MANAGER_HPP
+#define NTORRENT_CHOKE_MANAGER_HPP
+
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+
+#include <map>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Upload slots of a consumer that seeds while it downloads (BitTorrent choking).
+ *
+ * Peers are the downstream faces asking the consumer for pieces. Only `slots` of them are
+ * unchoked (served) at a time; Interests from choked peers are not answered, so they time
+ * out and are retried elsewhere, and the consumer's uplink stays free for its own Interests.
+ * Every rechoke() (one choke period) the slots go to the peers that were interested in the
+ * last period, best first: with reciprocation, the peers the consumer downloaded most from,
+ * otherwise the peers it uploaded most to. One slot is optimistic: it goes to a random other
+ * interested peer and only rotates every OPTIMISTIC_ROUNDS periods, so newcomers get a chance
+ * to reciprocate. Between rechokes, free slots go to the first peers asking.
+ *
+ * Interests carry no peer identity, so a face stands for every peer behind it: on a node with
+ * a single link all of them are one "peer", and the consumer does not choke there.
+ */
+class ChokeManager
+{
+public:
+  //Rechokes between two optimistic unchokes
+  static const uint32_t OPTIMISTIC_ROUNDS = 3;
+
+  ChokeManager();
+
+  //slots = 0 disables choking
+  void
+  configure(uint32_t slots, bool reciprocate, Ptr<UniformRandomVariable> rand);
+
+  //A request from face: true if face is unchoked and should be served
+  bool
+  allow(uint64_t face);
+
+  void
+  onUpload(uint64_t face, uint64_t bytes);
+
+  void
+  onDownload(uint64_t face, uint64_t bytes);
+
+  //Reassign the slots at the end of a choke period
+  void
+  rechoke();
+
+  //Requests not served because their peer was choked
+  uint64_t
+  getChokedRequests() const
+  {
+    return m_chokedRequests;
+  }
+
+private:
+  struct Peer
+  {
+    //Counted over the current choke period
+    uint64_t downloaded = 0;
+    uint64_t uploaded = 0;
+    bool interested = false;
+    bool unchoked = false;
+  };
+
+  uint32_t m_slots;
+  bool m_reciprocate;
+  Ptr<UniformRandomVariable> m_rand;
+
+  std::map<uint64_t, Peer> m_peers;
+  uint32_t m_unchoked;
+  uint64_t m_optimistic;
+  bool m_hasOptimistic;
+  uint32_t m_round;
+  uint64_t m_chokedRequests;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_CHOKE_MANAGER_HPP
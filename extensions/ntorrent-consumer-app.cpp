@@ -19,6 +19,14 @@
  */
 
 #include "ntorrent-consumer-app.hpp"
+#include "ntorrent-memory-tracer.hpp"
+#include "ntorrent-routing.hpp"
+#include "ntorrent-torrent-generator.hpp"
+
+#include "ns3/abort.h"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/security/verification-helpers.hpp>
 
 NS_LOG_COMPONENT_DEFINE("NTorrentConsumerApp");
 
@@ -31,7 +39,7 @@ TypeId
 NTorrentConsumerApp::GetTypeId(void)
 {
     static TypeId tid = TypeId("NTorrentConsumerApp")
-      .SetParent<Application>()
+      .SetParent<App>()
       .AddConstructor<NTorrentConsumerApp>()
       .AddAttribute("StartSeq", "Initial sequence number", IntegerValue(0),
                     MakeIntegerAccessor(&NTorrentConsumerApp::m_seq), MakeIntegerChecker<int32_t>())
@@ -44,12 +52,94 @@ NTorrentConsumerApp::GetTypeId(void)
                     MakeIntegerAccessor(&NTorrentConsumerApp::m_namesPerManifest), MakeIntegerChecker<int32_t>())
       .AddAttribute("dataPacketSize", "Size of each data packet", IntegerValue(64),
                     MakeIntegerAccessor(&NTorrentConsumerApp::m_dataPacketSize), MakeIntegerChecker<int32_t>())
-      .AddAttribute("LifeTime", "LifeTime for interest packet", StringValue("1s"),
-                    MakeTimeAccessor(&NTorrentConsumerApp::m_interestLifeTime), MakeTimeChecker());
+      .AddAttribute("LifeTime", "LifeTime for interest packet (upper bound when AdaptiveLifetime is set)",
+                    StringValue("1s"),
+                    MakeTimeAccessor(&NTorrentConsumerApp::m_interestLifeTime), MakeTimeChecker())
+      .AddAttribute("AdaptiveLifetime", "Derive Interest lifetimes and retransmissions from measured RTTs",
+                    BooleanValue(true), MakeBooleanAccessor(&NTorrentConsumerApp::m_adaptiveLifetime),
+                    MakeBooleanChecker())
+      .AddAttribute("MaxRetransmissions", "Retransmissions of an Interest before giving up on it (0: never give up)",
+                    IntegerValue(0), MakeIntegerAccessor(&NTorrentConsumerApp::m_maxRetransmissions),
+                    MakeIntegerChecker<uint32_t>())
+      .AddAttribute("CongestionControl", "Keep outstanding Interests within an AIMD window reacting to congestion marks (needs AdaptiveLifetime)",
+                    BooleanValue(false), MakeBooleanAccessor(&NTorrentConsumerApp::m_congestionControl),
+                    MakeBooleanChecker())
+      .AddAttribute("InitialWindow", "Initial congestion window (Interests)",
+                    IntegerValue(16), MakeIntegerAccessor(&NTorrentConsumerApp::m_initialWindow),
+                    MakeIntegerChecker<uint32_t>(1))
+      .AddAttribute("ImageDirectory", "Directory caching pre-encoded torrent images (empty: no image)",
+                    StringValue(""),
+                    MakeStringAccessor(&NTorrentConsumerApp::m_imageDirectory), MakeStringChecker())
+      .AddAttribute("VirtualFiles", "Fetch the synthetic torrent with this many files (0: use DUMMY_FILE_PATH)",
+                    IntegerValue(0), MakeIntegerAccessor(&NTorrentConsumerApp::m_virtualFiles),
+                    MakeIntegerChecker<uint32_t>())
+      .AddAttribute("VirtualPacketsPerFile", "Packets per synthetic file", IntegerValue(1024),
+                    MakeIntegerAccessor(&NTorrentConsumerApp::m_virtualPacketsPerFile),
+                    MakeIntegerChecker<uint32_t>())
+      .AddAttribute("PayloadSize", "Payload size of the synthetic packets", IntegerValue(1024),
+                    MakeIntegerAccessor(&NTorrentConsumerApp::m_virtualPayloadSize),
+                    MakeIntegerChecker<uint32_t>())
+      .AddAttribute("BundleSize", "Packets per Data in the synthetic torrent, must match the producer's (ignored for real files: raise dataPacketSize)",
+                    IntegerValue(1), MakeIntegerAccessor(&NTorrentConsumerApp::m_virtualBundleSize),
+                    MakeIntegerChecker<uint32_t>(1))
+      .AddAttribute("VerifyData", "Drop packets that don't chain to the initial torrent segment",
+                    BooleanValue(true), MakeBooleanAccessor(&NTorrentConsumerApp::m_verifyData),
+                    MakeBooleanChecker())
+      .AddAttribute("TorrentIndex", "Fetch all torrent segments and manifests through the torrent index",
+                    BooleanValue(true), MakeBooleanAccessor(&NTorrentConsumerApp::m_useTorrentIndex),
+                    MakeBooleanChecker())
+      .AddAttribute("HaveInterval", "Period of the have map advertisement to neighbors (0: don't advertise)",
+                    StringValue("0s"), MakeTimeAccessor(&NTorrentConsumerApp::m_haveInterval),
+                    MakeTimeChecker())
+      .AddAttribute("HaveMapBits", "Size in bits of the advertised have map (a Bloom filter)",
+                    IntegerValue(8192), MakeIntegerAccessor(&NTorrentConsumerApp::m_haveMapBits),
+                    MakeIntegerChecker<uint32_t>(8))
+      .AddAttribute("UploadRate", "Upload budget shared fairly by the downstream faces (0: unlimited)",
+                    StringValue("0bps"), MakeDataRateAccessor(&NTorrentConsumerApp::m_uploadRate),
+                    MakeDataRateChecker())
+      .AddAttribute("UploadQueue", "Responses queued per downstream face when UploadRate is set",
+                    IntegerValue(64), MakeIntegerAccessor(&NTorrentConsumerApp::m_uploadQueue),
+                    MakeIntegerChecker<uint32_t>(1))
+      .AddAttribute("StoreCapacity", "Bytes of data packets kept for seeding (0: keep everything)",
+                    IntegerValue(0), MakeIntegerAccessor(&NTorrentConsumerApp::m_storeCapacity),
+                    MakeIntegerChecker<uint64_t>())
+      .AddAttribute("EvictionPolicy", "Data packets evicted first past StoreCapacity: lru, lfu or rarest",
+                    StringValue("lru"), MakeStringAccessor(&NTorrentConsumerApp::m_evictionPolicy),
+                    MakeStringChecker())
+      .AddAttribute("UploadSlots", "Peers (downstream faces) served at a time while seeding, on multi-homed nodes only (0: every peer)",
+                    IntegerValue(0), MakeIntegerAccessor(&NTorrentConsumerApp::m_uploadSlots),
+                    MakeIntegerChecker<uint32_t>())
+      .AddAttribute("Reciprocate", "Give upload slots to the peers this consumer downloads most from",
+                    BooleanValue(true), MakeBooleanAccessor(&NTorrentConsumerApp::m_reciprocate),
+                    MakeBooleanChecker())
+      .AddAttribute("ChokeInterval", "Period between two reassignments of the upload slots",
+                    StringValue("10s"), MakeTimeAccessor(&NTorrentConsumerApp::m_chokeInterval),
+                    MakeTimeChecker())
+      .AddAttribute("Signature", "Fake signature of virtual packets (must match the producer's)",
+                    IntegerValue(0), MakeIntegerAccessor(&NTorrentConsumerApp::m_signature),
+                    MakeIntegerChecker<uint32_t>())
+      .AddAttribute("KeyLocator", "Key locator of virtual packets (must match the producer's)",
+                    NameValue(), MakeNameAccessor(&NTorrentConsumerApp::m_keyLocator), MakeNameChecker());
     return tid;
 }
 
 NTorrentConsumerApp::NTorrentConsumerApp()
+  : m_storedPackets(0)
+  , m_storeBytes(0)
+  , m_evictedPackets(0)
+  , m_uploads([this] (uint64_t peer, const std::shared_ptr<const Data>& data) {
+      //Only responses that leave the scheduler count towards the peer's upload rate
+      m_choker.onUpload(peer, data->wireEncode().size());
+      SendData(data);
+    })
+  , m_duplicatePackets(0)
+  , m_haveSeq(0)
+  , m_rand(CreateObject<UniformRandomVariable>())
+  , m_retransmittedInterests(0)
+  , m_congestionMarks(0)
+  , m_receivedParts(0)
+  , m_verifiedPackets(0)
+  , m_rejectedPackets(0)
 {
 }
 
@@ -57,32 +147,89 @@ NTorrentConsumerApp::~NTorrentConsumerApp()
 {
 }
 
+int64_t
+NTorrentConsumerApp::AssignStreams(int64_t stream)
+{
+    m_rand->SetStream(stream);
+    return 1;
+}
+
 void
 NTorrentConsumerApp::StartApplication()
 {
     App::StartApplication();
+    NS_ABORT_MSG_IF(m_congestionControl && !m_adaptiveLifetime,
+                    "CongestionControl counts outstanding Interests, it needs AdaptiveLifetime");
     ndn::FibHelper::AddRoute(GetNode(), "/", m_face, 0);
+    m_window = m_initialWindow;
+    m_lastWindowDecrease = Seconds(0);
+    m_uploads.setRate(m_uploadRate);
+    m_uploads.setQueueLimit(m_uploadQueue);
+    //Peers are told apart by the face their Interests come in on: a node with a single link
+    //sees the whole swarm through it, and choking would treat everyone as one peer
+    uint32_t uploadSlots = m_uploadSlots;
+    if (uploadSlots > 0 && GetNode()->GetNDevices() < 2) {
+        NS_LOG_WARN("UploadSlots needs a multi-homed node, choking disabled on node " << GetNode()->GetId());
+        uploadSlots = 0;
+    }
+    m_choker.configure(uploadSlots, m_reciprocate, m_rand);
+    if (uploadSlots > 0)
+        m_chokeEvent = Simulator::Schedule(m_chokeInterval, &NTorrentConsumerApp::Rechoke, this);
+    m_eviction = EvictionPolicy::create(m_evictionPolicy, m_rand);
+    NS_ABORT_MSG_IF(m_eviction == nullptr, "Unknown EvictionPolicy " << m_evictionPolicy);
     copyTorrentFile();
-
-    //Send interest for initial torrent segment
-    SendInterest(m_initialSegment.getFullName().toUri());
+    m_haveMap = HaveMap(m_haveMapBits);
+    m_haveMapStale = false;
+    if (!m_haveInterval.IsZero())
+        m_haveEvent = Simulator::Schedule(m_haveInterval, &NTorrentConsumerApp::AdvertiseHave, this);
+
+    //Send interest for the index root (it lists all metadata), or the initial torrent segment
+    Name first = m_torrentIndex != nullptr ? m_torrentIndex->getRoot().getFullName() :
+                                             m_initialSegment.getFullName();
+    m_expectedNames.insert(NameTable::get().intern(first));
+    SendInterest(first);
 }
 
 void
 NTorrentConsumerApp::StopApplication()
 {
+    NTorrentMemoryTracer::ReportNode(GetNode(), "stop");
+    NS_LOG_INFO("Verified packets: " << m_verifiedPackets << ", rejected: " << m_rejectedPackets);
+    NS_LOG_INFO("Pieces held: " << m_possession.size() << ", duplicates dropped: " << m_duplicatePackets);
+    NS_LOG_INFO("Retransmitted Interests: " << m_retransmittedInterests);
+    if (m_congestionControl)
+        NS_LOG_INFO("Congestion marks: " << m_congestionMarks << ", final window: " << m_window);
+    if (m_virtualBundleSize > 1)
+        NS_LOG_INFO("Bundled packets received: " << m_receivedParts);
+    if (m_uploadSlots > 0)
+        NS_LOG_INFO("Requests from choked peers: " << m_choker.getChokedRequests());
+    if (m_storeCapacity > 0)
+        NS_LOG_INFO("Data packets evicted: " << m_evictedPackets);
+    for (auto& pending : m_pendingInterests)
+        Simulator::Cancel(pending.second.timer);
+    m_pendingInterests.clear();
+    m_interestQueue.clear();
+    Simulator::Cancel(m_haveEvent);
+    m_uploads.clear();
+    Simulator::Cancel(m_chokeEvent);
     App::StopApplication();
 }
 
+void
+NTorrentConsumerApp::SendData(const std::shared_ptr<const Data>& data)
+{
+    m_transmittedDatas(data, this, m_face);
+    m_appLink->onReceiveData(*data);
+}
+
 void
 NTorrentConsumerApp::SendInterest()
 {
   //This function is just for testing for testing, not really going to be used..
   std::string interestName = std::string(ndn_ntorrent::SharedConstants::commonPrefix) + "/NTORRENT/" + to_string(m_seq++);
   auto interest = std::make_shared<Interest>(interestName);
-  Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable>();
-  interest->setNonce(rand->GetValue(0, std::numeric_limits<uint32_t>::max()));
-  interest->setInterestLifetime(ndn::time::seconds(1));
+  interest->setNonce(m_rand->GetValue(0, std::numeric_limits<uint32_t>::max()));
+  interest->setInterestLifetime(ndn::time::milliseconds(m_interestLifeTime.GetMilliSeconds()));
   NS_LOG_DEBUG("SEND INTEREST::: " << *interest);
   m_transmittedInterests(interest, this, m_face);
   m_appLink->onReceiveInterest(*interest);
@@ -91,15 +238,152 @@ NTorrentConsumerApp::SendInterest()
 void
 NTorrentConsumerApp::SendInterest(const string& interestName)
 {
+  SendInterest(Name(interestName));
+}
+
+void
+NTorrentConsumerApp::SendInterest(const Name& interestName)
+{
+  if (m_possession.has(NameTable::get().find(interestName))) {
+    NS_LOG_DEBUG("Already have " << interestName);
+    return;
+  }
+
+  //New names wait for room in the window, retransmissions don't
+  if (m_congestionControl && m_pendingInterests.size() >= m_window &&
+      m_pendingInterests.count(NameTable::get().intern(interestName)) == 0) {
+    m_interestQueue.push_back(interestName);
+    return;
+  }
+
   auto interest = std::make_shared<Interest>(interestName);
-  Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable>();
-  interest->setNonce(rand->GetValue(0, std::numeric_limits<uint32_t>::max()));
-  interest->setInterestLifetime(ndn::time::seconds(1));
+  interest->setNonce(m_rand->GetValue(0, std::numeric_limits<uint32_t>::max()));
+
+  Time lifetime = m_interestLifeTime;
+  if (m_adaptiveLifetime) {
+    NameId id = NameTable::get().intern(interestName);
+    auto inserted = m_pendingInterests.emplace(id, PendingInterest());
+    PendingInterest& pending = inserted.first->second;
+    if (inserted.second) {
+      pending.rtt = getRttEstimator(interestName);
+      pending.retransmissions = 0;
+    }
+
+    lifetime = std::min(lifetime, pending.rtt->RetransmitTimeout());
+    pending.sent = Simulator::Now();
+    Simulator::Cancel(pending.timer);
+    pending.timer = Simulator::Schedule(lifetime, &NTorrentConsumerApp::OnRetransmissionTimeout, this, id);
+  }
+
+  interest->setInterestLifetime(ndn::time::milliseconds(lifetime.GetMilliSeconds()));
   NS_LOG_DEBUG("SEND INTEREST::: " << *interest);
   m_transmittedInterests(interest, this, m_face);
   m_appLink->onReceiveInterest(*interest);
 }
 
+Ptr<RttEstimator>
+NTorrentConsumerApp::getRttEstimator(const Name& name)
+{
+  //Packets of one file (its manifests and data) tend to come over the same path
+  Name upstream = name;
+  switch (classifyName(name)) {
+    case ndn_ntorrent::IoUtil::DATA_PACKET:
+      upstream = name.getPrefix(-3);
+      break;
+    case ndn_ntorrent::IoUtil::FILE_MANIFEST:
+    case ndn_ntorrent::IoUtil::TORRENT_FILE:
+      upstream = name.getPrefix(-2);
+      break;
+    case ndn_ntorrent::IoUtil::UNKNOWN:
+      break;
+  }
+
+  Ptr<RttEstimator>& rtt = m_rttEstimators[upstream];
+  if (rtt == nullptr)
+    rtt = CreateObject<RttMeanDeviation>();
+  return rtt;
+}
+
+void
+NTorrentConsumerApp::OnRetransmissionTimeout(NameId id)
+{
+  auto it = m_pendingInterests.find(id);
+  if (it == m_pendingInterests.end())
+    return;
+
+  PendingInterest& pending = it->second;
+  const Name& name = NameTable::get().getName(id);
+  //Nothing requests a name again once it is given up on: the download stays incomplete
+  if (m_maxRetransmissions > 0 && pending.retransmissions >= m_maxRetransmissions) {
+    NS_LOG_WARN("Giving up on " << name << " after " << pending.retransmissions << " retransmissions");
+    m_pendingInterests.erase(it);
+    drainInterestQueue();
+    return;
+  }
+
+  if (m_congestionControl)
+    decreaseWindow(pending.rtt->GetCurrentEstimate());
+
+  //Back off until an unambiguous sample (Karn) brings the RTO back down
+  pending.retransmissions++;
+  pending.rtt->IncreaseMultiplier();
+  m_retransmittedInterests++;
+  NS_LOG_DEBUG("Retransmitting " << name << " (" << pending.retransmissions << ")");
+  SendInterest(name);
+}
+
+void
+NTorrentConsumerApp::decreaseWindow(Time rtt)
+{
+  //One reaction per round trip, however many of its packets were marked or lost
+  if (Simulator::Now() - m_lastWindowDecrease < rtt)
+    return;
+  m_window = std::max(1.0, m_window / 2);
+  m_lastWindowDecrease = Simulator::Now();
+  NS_LOG_DEBUG("Congestion window: " << m_window);
+}
+
+void
+NTorrentConsumerApp::drainInterestQueue()
+{
+  while (!m_interestQueue.empty() && m_pendingInterests.size() < m_window) {
+    Name name = m_interestQueue.front();
+    m_interestQueue.pop_front();
+    SendInterest(name);
+  }
+}
+
+void
+NTorrentConsumerApp::Rechoke()
+{
+  m_choker.rechoke();
+  m_chokeEvent = Simulator::Schedule(m_chokeInterval, &NTorrentConsumerApp::Rechoke, this);
+}
+
+void
+NTorrentConsumerApp::AdvertiseHave()
+{
+  if (m_haveMapStale) {
+    m_haveMap = HaveMap(m_haveMapBits);
+    for (const auto& response : m_responses) {
+      if (NameTable::get().getType(response.first) == ndn_ntorrent::IoUtil::DATA_PACKET)
+        m_haveMap.insert(HaveMap::hash(NameTable::get().getName(response.first)));
+    }
+    m_haveMapStale = false;
+  }
+
+  //Nothing to offer yet, neighbors keep no state about this node
+  if (m_haveMap.size() > 0) {
+    auto interest = std::make_shared<Interest>(m_haveMap.makeAdvertisement(GetNode()->GetId(), m_haveSeq++));
+    interest->setNonce(m_rand->GetValue(0, std::numeric_limits<uint32_t>::max()));
+    interest->setInterestLifetime(ndn::time::milliseconds(m_haveInterval.GetMilliSeconds()));
+    NS_LOG_DEBUG("Advertising " << m_haveMap.size() << " pieces");
+    m_transmittedInterests(interest, this, m_face);
+    m_appLink->onReceiveInterest(*interest);
+  }
+  m_haveEvent = Simulator::Schedule(m_haveInterval, &NTorrentConsumerApp::AdvertiseHave, this);
+}
+
 //TODO: Implement this method better...
 void
 NTorrentConsumerApp::OnInterest(shared_ptr<const Interest> interest)
@@ -107,23 +391,18 @@ NTorrentConsumerApp::OnInterest(shared_ptr<const Interest> interest)
     ndn::App::OnInterest(interest);
     const auto& interestName = interest->getName();
 
-    ndn_ntorrent::IoUtil::NAME_TYPE interestType = ndn_ntorrent::IoUtil::findType(interestName);
+    NameId interestId = NameTable::get().find(interestName);
+    ndn_ntorrent::IoUtil::NAME_TYPE interestType = interestId != INVALID_NAME_ID ?
+            NameTable::get().getType(interestId) : classifyName(interestName);
 
-    std::shared_ptr<Data> data = nullptr;
-
-    auto cmp = [&interestName](const Data& t){return t.getFullName() == interestName;};
+    std::shared_ptr<const Data> data = m_responses.find(interestId);
 
     switch(interestType)
     {
         case ndn_ntorrent::IoUtil::TORRENT_FILE:
         {
             NS_LOG_DEBUG("RECIEVED INTEREST (torrent-file):::" << interestName);
-            auto torrent_it =  std::find_if(m_torrentSegments.begin(), m_torrentSegments.end(), cmp);
-
-            if (m_torrentSegments.end() != torrent_it) {
-                data = std::make_shared<Data>(*torrent_it);
-            }
-            else{
+            if (nullptr == data) {
                 NS_LOG_ERROR("Don't have this torrent...");
             }
             break;
@@ -131,11 +410,7 @@ NTorrentConsumerApp::OnInterest(shared_ptr<const Interest> interest)
         case ndn_ntorrent::IoUtil::FILE_MANIFEST:
         {
             NS_LOG_DEBUG("RECIEVED INTEREST (file-manifest):::" << interestName);
-            auto manifest_it = std::find_if(manifests.begin(), manifests.end(), cmp);
-            if (manifests.end() != manifest_it) {
-                data = std::make_shared<Data>(*manifest_it) ;
-            }
-            else{
+            if (nullptr == data) {
                 NS_LOG_ERROR("Don't have this manifest...");
             }
             break;
@@ -143,11 +418,7 @@ NTorrentConsumerApp::OnInterest(shared_ptr<const Interest> interest)
         case ndn_ntorrent::IoUtil::DATA_PACKET:
         {
             NS_LOG_DEBUG("RECIEVED INTEREST (data-packet):::" << interestName);
-            auto data_it = std::find_if(dataPackets.begin(), dataPackets.end(), cmp);
-            if (dataPackets.end() != data_it) {
-                data = std::make_shared<Data>(*data_it) ;
-            }
-            else{
+            if (nullptr == data) {
                 NS_LOG_ERROR("Don't have this data...");
             }
             break;
@@ -161,22 +432,15 @@ NTorrentConsumerApp::OnInterest(shared_ptr<const Interest> interest)
 
     if(nullptr != data && interestType != ndn_ntorrent::IoUtil::UNKNOWN)
     {
-        /*Signature signature;
-        SignatureInfo signatureInfo(static_cast< ::ndn::tlv::SignatureTypeValue>(255));
-
-        if (m_keyLocator.size() > 0) {
-            signatureInfo.setKeyLocator(m_keyLocator);
+        uint64_t peer = getIncomingFaceId(*interest);
+        if (!m_choker.allow(peer)) {
+            NS_LOG_DEBUG("Peer on face " << peer << " is choked");
+            return;
         }
-
-        signature.setInfo(signatureInfo);
-        signature.setValue(::ndn::makeNonNegativeIntegerBlock(::ndn::tlv::SignatureValue, m_signature));
-
-        data->setSignature(signature);
-        NS_LOG_INFO("node(" << GetNode()->GetId() << ") responding with Data: " << data->getName());*/
-
-        data->wireEncode();
-        m_transmittedDatas(data, this, m_face);
-        m_appLink->onReceiveData(*data);
+        if (interestType == ndn_ntorrent::IoUtil::DATA_PACKET)
+            m_eviction->access(interestId);
+        //Responses keep the producer's signature and encoding, see ResponseCache
+        m_uploads.enqueue(*interest, data);
     }
 }
 
@@ -188,12 +452,41 @@ NTorrentConsumerApp::copyTorrentFile()
     //Since that isn't possible here, just generate the same torrent file on producer and consumer
 
     NS_LOG_DEBUG("Copying torrent file!");
-    const auto& content = ndn_ntorrent::TorrentFile::generate(ndn_ntorrent::DUMMY_FILE_PATH,
+    if (m_virtualFiles > 0) {
+        m_virtualTorrent = std::make_shared<VirtualTorrent>(m_virtualFiles, m_virtualPacketsPerFile,
+                m_virtualPayloadSize, m_namesPerSegment, m_namesPerManifest, m_virtualBundleSize,
+                m_signature, m_keyLocator);
+        m_initialSegment = m_virtualTorrent->getInitialSegment();
+        if (m_useTorrentIndex)
+            m_torrentIndex = TorrentIndex::create(m_virtualTorrent->getTorrentSegments(),
+                    m_virtualTorrent->getManifests(), m_namesPerManifest);
+        return;
+    }
+
+    if (!m_imageDirectory.empty()) {
+        auto image = TorrentImage::open(m_imageDirectory, ndn_ntorrent::DUMMY_FILE_PATH,
+                m_namesPerSegment, m_namesPerManifest, m_dataPacketSize);
+        if (image != nullptr) {
+            m_initialSegment = image->torrentSegments().at(0);
+            if (m_useTorrentIndex)
+                m_torrentIndex = TorrentIndex::create(image->torrentSegments(), image->manifests(),
+                        m_namesPerManifest);
+            return;
+        }
+    }
+
+    const auto& content = generateTorrent(ndn_ntorrent::DUMMY_FILE_PATH,
             m_namesPerSegment, m_namesPerManifest, m_dataPacketSize, true);
 
-    //Copy only initial segment. Nothing else will be used.
+    //Copy only initial segment (and the index, which is all the consumer knows beforehand).
     //This will be used to make future requests
     m_initialSegment = content.first.at(0);
+    if (m_useTorrentIndex) {
+        std::vector<ndn_ntorrent::FileManifest> allManifests;
+        for (const auto& ms : content.second)
+            allManifests.insert(allManifests.end(), ms.first.begin(), ms.first.end());
+        m_torrentIndex = TorrentIndex::create(content.first, allManifests, m_namesPerManifest);
+    }
 }
 
 void
@@ -201,18 +494,58 @@ NTorrentConsumerApp::OnData(shared_ptr<const Data> data)
 {
     NS_LOG_DEBUG("RECEIVED: " << data->getFullName());
     //NS_LOG_DEBUG("RECEIVED: " << data->getFullName() << " from face: " << m_face.get()->getId());
-    ndn_ntorrent::IoUtil::NAME_TYPE interestType = ndn_ntorrent::IoUtil::findType(data->getFullName());
+    ndn_ntorrent::IoUtil::NAME_TYPE interestType = classifyName(data->getFullName());
+    NameId id = NameTable::get().intern(data->getFullName());
+
+    //Multicast forwarding delivers one copy per upstream: keep (and announce) only the first.
+    //Copies are counted here only, not in the ReceivedDatas trace App::OnData fires
+    if(interestType != ndn_ntorrent::IoUtil::UNKNOWN && m_possession.has(id))
+    {
+        m_duplicatePackets++;
+        return;
+    }
+    App::OnData(data);
+
+    if(m_verifyData && interestType != ndn_ntorrent::IoUtil::UNKNOWN && !verify(*data, interestType))
+    {
+        return;
+    }
+
+    auto pending = m_pendingInterests.find(id);
+    if (pending != m_pendingInterests.end())
+    {
+        //Samples of retransmitted Interests are ambiguous and skipped
+        if (pending->second.retransmissions == 0) {
+            pending->second.rtt->Measurement(Simulator::Now() - pending->second.sent);
+            pending->second.rtt->ResetMultiplier();
+        }
+        Simulator::Cancel(pending->second.timer);
+
+        if (m_congestionControl) {
+            auto mark = data->getTag<lp::CongestionMarkTag>();
+            if (mark != nullptr && mark->get() > 0) {
+                m_congestionMarks++;
+                decreaseWindow(pending->second.rtt->GetCurrentEstimate());
+            }
+            else {
+                m_window += 1 / m_window;
+            }
+        }
+        m_pendingInterests.erase(pending);
+        if (m_congestionControl)
+            drainInterestQueue();
+    }
 
     //shared_ptr<nfd::Forwarder> m_forwarder = GetNode()->GetObject<L3Protocol>()->getForwarder();
     //nfd::Fib& fib = m_forwarder.get()->getFib();
     if(interestType != ndn_ntorrent::IoUtil::UNKNOWN)
     {
+        m_choker.onDownload(getIncomingFaceId(*data), data->wireEncode().size());
+        m_possession.insert(id);
+        if (interestType == ndn_ntorrent::IoUtil::DATA_PACKET)
+            m_haveMap.insert(HaveMap::hash(data->getFullName()));
         ndn::FibHelper::AddRoute(GetNode(), data->getFullName(), m_face, 0);
-        GlobalRoutingHelper ndnGlobalRoutingHelper;
-        ndnGlobalRoutingHelper.AddOrigin(data->getFullName().toUri(), GetNode());
-        
-        GlobalRoutingHelper::CalculateRoutes();
-        //GlobalRoutingHelper::CalculateAllPossibleRoutes();
+        NTorrentRouting::announce(GetNode(), data->getFullName());
     }
     
     /*Verify FIB entries
@@ -227,14 +560,30 @@ NTorrentConsumerApp::OnData(shared_ptr<const Data> data)
     {
         case ndn_ntorrent::IoUtil::TORRENT_FILE:
         {
+            m_responses.insert(*data);
+            if (TorrentIndex::isIndexName(data->getFullName())) {
+                //Every torrent segment, manifest and remaining index segment, all at once
+                std::vector<Name> names = TorrentIndex::decode(*data);
+                expect(names, nullptr);
+                for (const auto& name : names)
+                    SendInterest(name);
+                break;
+            }
+
             ndn_ntorrent::TorrentFile file(data->wireEncode());
             m_torrentSegments.push_back(file);
 
             std::vector<Name> manifestCatalog = file.getCatalog();
             shared_ptr<Name> nextSegmentPtr = file.getTorrentFilePtr();
+            expect(manifestCatalog, nextSegmentPtr);
+            m_possession.addCatalog(id, manifestCatalog);
+            //The index already asked for the next segment and the manifests
+            if (m_torrentIndex != nullptr)
+                break;
+
             if(nextSegmentPtr!=nullptr)
             {
-                SendInterest(nextSegmentPtr.get()->toUri());
+                SendInterest(*nextSegmentPtr);
             }
             else
             {
@@ -243,20 +592,24 @@ NTorrentConsumerApp::OnData(shared_ptr<const Data> data)
 
             for(uint8_t i=0; i<manifestCatalog.size(); i++)
             {
-                SendInterest(manifestCatalog.at(i).toUri());
+                SendInterest(manifestCatalog.at(i));
             }
             break;
         }
         case ndn_ntorrent::IoUtil::FILE_MANIFEST:
         {
+            m_responses.insert(*data);
             ndn_ntorrent::FileManifest fm(data->wireEncode());
             manifests.push_back(fm);
 
             std::vector<Name> subManifestCatalog = fm.catalog();
             shared_ptr<Name> nextSegmentPtr = fm.submanifest_ptr();
-            if(nextSegmentPtr!=nullptr)
+            expect(subManifestCatalog, nextSegmentPtr);
+            m_possession.addCatalog(id, subManifestCatalog);
+            //The index already asked for the submanifest
+            if(nextSegmentPtr!=nullptr && m_torrentIndex == nullptr)
             {
-                SendInterest(nextSegmentPtr.get()->toUri());
+                SendInterest(*nextSegmentPtr);
             }
             else
             {
@@ -265,20 +618,36 @@ NTorrentConsumerApp::OnData(shared_ptr<const Data> data)
 
             for(uint8_t i=0; i<subManifestCatalog.size(); i++)
             {
-                SendInterest(subManifestCatalog.at(i).toUri());
+                SendInterest(subManifestCatalog.at(i));
             }
             break;
         }
         case ndn_ntorrent::IoUtil::DATA_PACKET:
         {
-            Data d(data->wireEncode());
-            dataPackets.push_back(d);
-            Block content = d.getContent();
-            std::string output(content.value_begin(), content.value_end());
-            NS_LOG_DEBUG("DATA RECEIVED:");
-            NS_LOG_DEBUG("=== BEGIN ===");
-            std::cout << output << std::endl;
-            NS_LOG_DEBUG("=== END ===");
+            std::shared_ptr<const Data> stored = m_responses.insert(*data);
+            const Data& d = *stored;
+            m_storedPackets++;
+            m_storeBytes += d.wireEncode().size();
+            m_eviction->insert(id);
+            NameTable::get().addHolders(id, 1);
+            //A bundle was verified as a whole (by digest), its parts only need unpacking
+            if (m_virtualTorrent != nullptr && m_virtualTorrent->getBundleSize() > 1) {
+                std::vector<Block> parts;
+                if (m_virtualTorrent->unpackBundle(d, parts))
+                    m_receivedParts += parts.size();
+                else
+                    NS_LOG_ERROR("Malformed bundle: " << d.getName());
+            }
+            //Synthetic payloads are binary, don't print them
+            if (m_virtualFiles == 0) {
+                Block content = d.getContent();
+                std::string output(content.value_begin(), content.value_end());
+                NS_LOG_DEBUG("DATA RECEIVED:");
+                NS_LOG_DEBUG("=== BEGIN ===");
+                std::cout << output << std::endl;
+                NS_LOG_DEBUG("=== END ===");
+            }
+            enforceCapacity();
             break;
         }
         case ndn_ntorrent::IoUtil::UNKNOWN:
@@ -288,6 +657,34 @@ NTorrentConsumerApp::OnData(shared_ptr<const Data> data)
         }
     }
 }
+void
+NTorrentConsumerApp::enforceCapacity()
+{
+    while (m_storeCapacity > 0 && m_storeBytes > m_storeCapacity) {
+        NameId victim = m_eviction->victim();
+        if (victim == INVALID_NAME_ID)
+            break;
+        m_eviction->erase(victim);
+
+        std::shared_ptr<const Data> data = m_responses.find(victim);
+        if (data == nullptr)
+            continue;
+        NS_LOG_DEBUG("Evicting " << data->getFullName());
+        m_storedPackets--;
+        m_storeBytes -= data->wireEncode().size();
+        m_responses.erase(victim);
+        m_possession.erase(victim);
+        NameTable::get().addHolders(victim, -1);
+        //It was verified once; fetching it again must pass verification again
+        if (m_verifyData)
+            m_expectedNames.insert(victim);
+        ndn::FibHelper::RemoveRoute(GetNode(), data->getFullName(), m_face);
+        NTorrentRouting::withdraw(GetNode(), data->getFullName());
+        m_evictedPackets++;
+        m_haveMapStale = true;
+    }
+}
+
 void
 NTorrentConsumerApp::OnNack(shared_ptr<const lp::Nack> nack)
 {
@@ -297,5 +694,96 @@ NTorrentConsumerApp::OnNack(shared_ptr<const lp::Nack> nack)
               << ", reason: " << nack->getReason());
 }
 
+//Signature type setFakeSignature gives simulated packets
+static const uint32_t FAKE_SIGNATURE_TYPE = 255;
+
+bool
+NTorrentConsumerApp::verifySignature(const Data& data) const
+{
+    const ::ndn::Signature& signature = data.getSignature();
+    if (signature.getType() == ::ndn::tlv::DigestSha256)
+        return ::ndn::security::verifyDigest(data, ::ndn::DigestAlgorithm::SHA256);
+
+    //Simulated producers have no real keys: their signature is only as good as its value
+    if (signature.getType() == FAKE_SIGNATURE_TYPE) {
+        try {
+            if (::ndn::readNonNegativeInteger(signature.getValue()) != m_signature)
+                return false;
+        }
+        catch (const ::ndn::tlv::Error&) {
+            return false;
+        }
+        if (m_keyLocator.empty())
+            return !signature.hasKeyLocator();
+        return signature.hasKeyLocator() && signature.getKeyLocator().getType() == ::ndn::KeyLocator::KeyLocator_Name &&
+               signature.getKeyLocator().getName() == m_keyLocator;
+    }
+    return false;
+}
+
+bool
+NTorrentConsumerApp::verify(const Data& data, ndn_ntorrent::IoUtil::NAME_TYPE type)
+{
+    const Name& fullName = data.getFullName();
+    NameId id = NameTable::get().find(fullName);
+    auto expected = m_expectedNames.find(id);
+
+    if (expected == m_expectedNames.end()) {
+        //Already verified and stored: a duplicate, not an attack
+        if (m_responses.find(id) == nullptr) {
+            NS_LOG_WARN("Rejecting packet no verified catalog lists: " << fullName);
+            m_rejectedPackets++;
+        }
+        return false;
+    }
+
+    if (type != ndn_ntorrent::IoUtil::DATA_PACKET && !verifySignature(data)) {
+        NS_LOG_WARN("Rejecting packet with a bad signature: " << fullName);
+        m_rejectedPackets++;
+        return false;
+    }
+
+    m_expectedNames.erase(expected);
+    m_verifiedPackets++;
+    return true;
+}
+
+void
+NTorrentConsumerApp::expect(const std::vector<Name>& catalog, const shared_ptr<Name>& next)
+{
+    if (!m_verifyData)
+        return;
+
+    //With the index, a name may arrive before the catalog listing it: don't expect it twice
+    for (const auto& name : catalog) {
+        NameId id = NameTable::get().intern(name);
+        if (m_responses.find(id) == nullptr)
+            m_expectedNames.insert(id);
+    }
+    if (next != nullptr) {
+        NameId id = NameTable::get().intern(*next);
+        if (m_responses.find(id) == nullptr)
+            m_expectedNames.insert(id);
+    }
+}
+
+MemoryUsageList
+NTorrentConsumerApp::getMemoryUsage() const
+{
+    MemoryUsageList usage;
+    usage.push_back(dataStoreUsage("torrentSegments", m_torrentSegments));
+    usage.push_back(dataStoreUsage("manifests", manifests));
+    usage.push_back(MemoryUsage{"dataPackets", m_storedPackets, m_storeBytes});
+    usage.push_back(m_responses.getMemoryUsage("responses"));
+    usage.push_back(m_possession.getMemoryUsage("possession"));
+    usage.push_back(MemoryUsage{"haveMap", m_haveMap.size(), m_haveMap.getSizeInBytes()});
+
+    usage.push_back(MemoryUsage{"expectedNames", m_expectedNames.size(),
+                                m_expectedNames.size() * (sizeof(NameId) + CONTAINER_NODE_BYTES)});
+    usage.push_back(MemoryUsage{"pendingInterests", m_pendingInterests.size(),
+                                m_pendingInterests.size() * (sizeof(NameId) + sizeof(PendingInterest) + CONTAINER_NODE_BYTES)});
+    return usage;
+}
+
 } // namespace ndn
 } // namespace ns3
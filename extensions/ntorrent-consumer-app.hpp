@@ -21,12 +21,18 @@
 #include <ndn-cxx/data.hpp>
 #include <ndn-cxx/encoding/tlv.hpp>
 
+#include <deque>
+#include <unordered_set>
+
 #include "ns3/ndnSIM-module.h"
+#include "ns3/boolean.h"
 #include "ns3/integer.h"
+#include "ns3/data-rate.h"
 #include "ns3/string.h"
 #include "apps/ndn-app.hpp"
 #include "NFD/rib/rib-manager.hpp"
 #include "ns3/ndnSIM/helper/ndn-strategy-choice-helper.hpp"
+#include "ns3/ndnSIM/utils/ndn-rtt-mean-deviation.hpp"
 
 #include "src/torrent-file.hpp"
 #include "src/file-manifest.hpp"
@@ -35,6 +41,18 @@
 #include "src/util/simulation-constants.hpp"
 #include "src/util/io-util.hpp"
 
+#include "ntorrent-choke-manager.hpp"
+#include "ntorrent-eviction-policy.hpp"
+#include "ntorrent-have-map.hpp"
+#include "ntorrent-memory-usage.hpp"
+#include "ntorrent-name-table.hpp"
+#include "ntorrent-possession-map.hpp"
+#include "ntorrent-response-cache.hpp"
+#include "ntorrent-torrent-image.hpp"
+#include "ntorrent-upload-scheduler.hpp"
+#include "ntorrent-torrent-index.hpp"
+#include "ntorrent-virtual-torrent.hpp"
+
 namespace ndn_ntorrent = ndn::ntorrent;
 namespace nfd_rib = nfd::rib;
 namespace nfd_fw = nfd::fw;
@@ -51,6 +69,13 @@ public:
   NTorrentConsumerApp();
   ~NTorrentConsumerApp();
 
+  /**
+   * @brief Pin the nonce generator to a fixed RNG stream
+   * @return Number of streams used
+   */
+  int64_t
+  AssignStreams(int64_t stream);
+
   virtual void
   StartApplication();
 
@@ -72,13 +97,130 @@ public:
   virtual void
   SendInterest(const string& interestName);
 
+  virtual void
+  SendInterest(const Name& interestName);
+
   virtual void
   OnNack(shared_ptr<const lp::Nack> nack);
 
+  /**
+   * @brief Objects and (estimated) bytes held by each of the app's stores
+   */
+  MemoryUsageList
+  getMemoryUsage() const;
+
+  //Packets accepted / dropped by the verification pipeline (VerifyData)
+  uint64_t
+  getVerifiedPackets() const
+  {
+    return m_verifiedPackets;
+  }
+
+  uint64_t
+  getRejectedPackets() const
+  {
+    return m_rejectedPackets;
+  }
+
+  //Copies of packets already held, dropped on arrival
+  uint64_t
+  getDuplicatePackets() const
+  {
+    return m_duplicatePackets;
+  }
+
+private:
+  //Hand a response to the app face (called by m_uploads)
+  void
+  SendData(const std::shared_ptr<const Data>& data);
+
+private:
+  /**
+   * @brief Check data against the trust chain rooted at the initial segment
+   *
+   * A packet is accepted if its full name is listed by an already verified torrent segment or
+   * manifest (or is the initial segment). Torrent segments and manifests have their signature
+   * checked once, on arrival, before their catalogs are trusted; data packets are covered by
+   * the implicit digest in the catalog alone.
+   */
+  bool
+  verify(const Data& data, ndn_ntorrent::IoUtil::NAME_TYPE type);
+
+  /**
+   * @brief Digest signatures are checked for real; the fake signature of simulated producers
+   * must carry the configured Signature value and KeyLocator. Any other type is rejected.
+   */
+  bool
+  verifySignature(const Data& data) const;
+
+  //Names listed by a verified catalog (and its next segment/submanifest pointer)
+  void
+  expect(const std::vector<Name>& catalog, const shared_ptr<Name>& next);
+
+  //RTT estimator of the upstream serving name: one per file, one for the torrent file
+  Ptr<RttEstimator>
+  getRttEstimator(const Name& name);
+
+  void
+  OnRetransmissionTimeout(NameId id);
+
+  //Halve the congestion window, at most once per rtt
+  void
+  decreaseWindow(Time rtt);
+
+  //Send queued Interests while the window has room
+  void
+  drainInterestQueue();
+
+  //Evict data packets (and withdraw their routes) until the store fits StoreCapacity
+  void
+  enforceCapacity();
+
+  //End of a choke period: reassign the upload slots, then schedule the next one
+  void
+  Rechoke();
+
+  //Send the have map of the data packets held to the neighbors, then schedule the next one
+  void
+  AdvertiseHave();
+
 private:
   std::vector<ndn_ntorrent::TorrentFile> m_torrentSegments;
   std::vector<ndn_ntorrent::FileManifest> manifests;
-  std::vector<Data> dataPackets;
+  ResponseCache m_responses;
+
+  //Data packets live in m_responses; past StoreCapacity bytes (0: unbounded) the eviction
+  //policy picks which ones to give up
+  uint64_t m_storeCapacity;
+  std::string m_evictionPolicy;
+  std::unique_ptr<EvictionPolicy> m_eviction;
+  uint64_t m_storedPackets;
+  uint64_t m_storeBytes;
+  uint64_t m_evictedPackets;
+
+  //Responses are shared fairly between downstream faces at UploadRate (0: unlimited)
+  DataRate m_uploadRate;
+  uint32_t m_uploadQueue;
+  UploadScheduler m_uploads;
+
+  //Upload slots (0: serve every peer), reassigned every m_chokeInterval
+  uint32_t m_uploadSlots;
+  bool m_reciprocate;
+  Time m_chokeInterval;
+  ChokeManager m_choker;
+  EventId m_chokeEvent;
+  //Checked before storing, announcing or requesting anything
+  PossessionMap m_possession;
+  uint64_t m_duplicatePackets;
+
+  //Summary of m_possession's data packets, advertised every m_haveInterval (0: never)
+  Time m_haveInterval;
+  uint32_t m_haveMapBits;
+  HaveMap m_haveMap;
+  //Bloom filters can't forget: rebuilt before the next advertisement after an eviction
+  bool m_haveMapStale;
+  uint64_t m_haveSeq;
+  EventId m_haveEvent;
                 
   nfd_rib::Rib m_rib;
 
@@ -86,6 +228,32 @@ private:
   uint32_t m_seq; 
   Name m_interestName;
   Time m_interestLifeTime;
+  Ptr<UniformRandomVariable> m_rand;
+
+  //Adaptive lifetime: Interests live for the RTO of their upstream (at most LifeTime) and are
+  //retransmitted when it expires, with exponential backoff
+  struct PendingInterest
+  {
+    Ptr<RttEstimator> rtt;
+    Time sent;
+    uint32_t retransmissions;
+    EventId timer;
+  };
+
+  bool m_adaptiveLifetime;
+  uint32_t m_maxRetransmissions;
+  std::unordered_map<Name, Ptr<RttEstimator>> m_rttEstimators;
+  std::unordered_map<NameId, PendingInterest> m_pendingInterests;
+  uint64_t m_retransmittedInterests;
+
+  //AIMD window over m_pendingInterests (needs AdaptiveLifetime): +1 per window of Data,
+  //halved on congestion marks and timeouts; Interests over the window wait in a queue
+  bool m_congestionControl;
+  uint32_t m_initialWindow;
+  double m_window;
+  Time m_lastWindowDecrease;
+  std::deque<Name> m_interestQueue;
+  uint64_t m_congestionMarks;
   
   ndn_ntorrent::TorrentFile m_initialSegment;
   
@@ -95,6 +263,28 @@ private:
   uint32_t m_namesPerSegment;
   uint32_t m_namesPerManifest;
   uint32_t m_dataPacketSize;
+
+  //Must match the producer's, so both generate the same virtual torrent
+  uint32_t m_virtualFiles;
+  uint32_t m_virtualPacketsPerFile;
+  uint32_t m_virtualPayloadSize;
+  uint32_t m_virtualBundleSize;
+  std::shared_ptr<VirtualTorrent> m_virtualTorrent;
+  uint64_t m_receivedParts;
+  uint32_t m_signature;
+  Name m_keyLocator;
+
+  bool m_verifyData;
+  std::unordered_set<NameId> m_expectedNames;
+  uint64_t m_verifiedPackets;
+  uint64_t m_rejectedPackets;
+
+  //Directory of pre-encoded torrent images (empty: always run TorrentFile::generate)
+  std::string m_imageDirectory;
+
+  //Metadata is fetched through the index instead of walking the segment/submanifest pointers
+  bool m_useTorrentIndex;
+  std::shared_ptr<const TorrentIndex> m_torrentIndex;
 };
 
 } // namespace ndn
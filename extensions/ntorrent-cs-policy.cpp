@@ -0,0 +1,122 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-cs-policy.hpp"
+#include "ntorrent-name-table.hpp"
+
+#include "table/cs.hpp"
+
+namespace nfd {
+namespace cs {
+
+const std::string NTorrentCsPolicy::POLICY_NAME = "ntorrent";
+NFD_REGISTER_CS_POLICY(NTorrentCsPolicy);
+
+//Eviction order of the packet classes
+enum {
+  CLASS_OTHER = 0,
+  CLASS_DATA = 1,
+  CLASS_METADATA = 2
+};
+
+static int
+getClass(const Entry& entry)
+{
+  const Name& name = entry.getFullName();
+  ns3::ndn::NameTable& names = ns3::ndn::NameTable::get();
+  ns3::ndn::NameId id = names.find(name);
+  switch (id != ns3::ndn::INVALID_NAME_ID ? names.getType(id) : ns3::ndn::classifyName(name)) {
+    case ndn_ntorrent::IoUtil::TORRENT_FILE:
+    case ndn_ntorrent::IoUtil::FILE_MANIFEST:
+      return CLASS_METADATA;
+    case ndn_ntorrent::IoUtil::DATA_PACKET:
+      return CLASS_DATA;
+    case ndn_ntorrent::IoUtil::UNKNOWN:
+      break;
+  }
+  return CLASS_OTHER;
+}
+
+NTorrentCsPolicy::NTorrentCsPolicy()
+  : Policy(POLICY_NAME)
+  , m_clock(0)
+{
+}
+
+void
+NTorrentCsPolicy::update(iterator i, bool isHit)
+{
+  auto it = m_keys.find(&*i);
+  if (it == m_keys.end()) {
+    Key key(getClass(*i), 0, m_clock++);
+    m_keys.emplace(&*i, key);
+    m_order.emplace(key, i);
+    return;
+  }
+
+  m_order.erase(it->second);
+  it->second = Key(std::get<0>(it->second), std::get<1>(it->second) + (isHit ? 1 : 0), m_clock++);
+  m_order.emplace(it->second, i);
+}
+
+void
+NTorrentCsPolicy::doAfterInsert(iterator i)
+{
+  update(i, false);
+  this->evictEntries();
+}
+
+void
+NTorrentCsPolicy::doAfterRefresh(iterator i)
+{
+  update(i, false);
+}
+
+void
+NTorrentCsPolicy::doBeforeErase(iterator i)
+{
+  auto it = m_keys.find(&*i);
+  if (it == m_keys.end())
+    return;
+  m_order.erase(it->second);
+  m_keys.erase(it);
+}
+
+void
+NTorrentCsPolicy::doBeforeUse(iterator i)
+{
+  update(i, true);
+}
+
+void
+NTorrentCsPolicy::evictEntries()
+{
+  BOOST_ASSERT(this->getCs() != nullptr);
+  while (this->getCs()->size() > this->getLimit()) {
+    BOOST_ASSERT(!m_order.empty());
+    iterator i = m_order.begin()->second;
+    m_order.erase(m_order.begin());
+    m_keys.erase(&*i);
+    this->emitSignal(beforeEvict, i);
+  }
+}
+
+} // namespace cs
+} // namespace nfd
@@ -0,0 +1,84 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_CS_POLICY_HPP
+#define NTORRENT_CS_POLICY_HPP
+
+#include "table/cs-policy.hpp"
+
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace nfd {
+namespace cs {
+
+/*
+ * @brief Content Store replacement policy aware of nTorrent packet types.
+ *
+ * Every new consumer of a torrent starts with its segments and manifests, while each data
+ * packet is wanted by fewer consumers at a time; an LRU cache lets a burst of data flush the
+ * metadata. This policy evicts packets by class first: non-torrent packets, then data
+ * packets, then torrent segments and manifests. Within a class the least used packet (cache
+ * hits since it was inserted) goes first, the least recently used among equals, so popular
+ * pieces stay as well.
+ *
+ * Registered as "ntorrent"; see useTorrentCsPolicy() in scenarios/simulation-common.hpp.
+ */
+class NTorrentCsPolicy : public Policy
+{
+public:
+  NTorrentCsPolicy();
+
+  static const std::string POLICY_NAME;
+
+private:
+  void
+  doAfterInsert(iterator i) override;
+
+  void
+  doAfterRefresh(iterator i) override;
+
+  void
+  doBeforeErase(iterator i) override;
+
+  void
+  doBeforeUse(iterator i) override;
+
+  void
+  evictEntries() override;
+
+private:
+  //(class, hits, last use): the first key is evicted first
+  typedef std::tuple<int, uint64_t, uint64_t> Key;
+
+  void
+  update(iterator i, bool isHit);
+
+private:
+  std::map<Key, iterator> m_order;
+  std::unordered_map<const Entry*, Key> m_keys;
+  uint64_t m_clock;
+};
+
+} // namespace cs
+} // namespace nfd
+
+#endif // NTORRENT_CS_POLICY_HPP
@@ -0,0 +1,166 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-eviction-policy.hpp"
+
+namespace ns3 {
+namespace ndn {
+
+std::unique_ptr<EvictionPolicy>
+EvictionPolicy::create(const std::string& name, Ptr<UniformRandomVariable> rand)
+{
+  if (name == "lru")
+    return std::unique_ptr<EvictionPolicy>(new LruEvictionPolicy());
+  if (name == "lfu")
+    return std::unique_ptr<EvictionPolicy>(new LfuEvictionPolicy());
+  if (name == "rarest")
+    return std::unique_ptr<EvictionPolicy>(new RarestEvictionPolicy(rand));
+  return nullptr;
+}
+
+void
+LruEvictionPolicy::insert(NameId id)
+{
+  if (m_index.count(id) > 0) {
+    access(id);
+    return;
+  }
+  m_queue.push_front(id);
+  m_index[id] = m_queue.begin();
+}
+
+void
+LruEvictionPolicy::access(NameId id)
+{
+  auto it = m_index.find(id);
+  if (it != m_index.end())
+    m_queue.splice(m_queue.begin(), m_queue, it->second);
+}
+
+void
+LruEvictionPolicy::erase(NameId id)
+{
+  auto it = m_index.find(id);
+  if (it == m_index.end())
+    return;
+  m_queue.erase(it->second);
+  m_index.erase(it);
+}
+
+NameId
+LruEvictionPolicy::victim()
+{
+  return m_queue.empty() ? INVALID_NAME_ID : m_queue.back();
+}
+
+void
+LfuEvictionPolicy::insert(NameId id)
+{
+  if (m_index.count(id) > 0) {
+    access(id);
+    return;
+  }
+  Key key(0, m_clock++, id);
+  m_order.insert(key);
+  m_index[id] = key;
+}
+
+void
+LfuEvictionPolicy::access(NameId id)
+{
+  auto it = m_index.find(id);
+  if (it == m_index.end())
+    return;
+  m_order.erase(it->second);
+  it->second = Key(std::get<0>(it->second) + 1, m_clock++, id);
+  m_order.insert(it->second);
+}
+
+void
+LfuEvictionPolicy::erase(NameId id)
+{
+  auto it = m_index.find(id);
+  if (it == m_index.end())
+    return;
+  m_order.erase(it->second);
+  m_index.erase(it);
+}
+
+NameId
+LfuEvictionPolicy::victim()
+{
+  return m_order.empty() ? INVALID_NAME_ID : std::get<2>(*m_order.begin());
+}
+
+const uint32_t RarestEvictionPolicy::SAMPLES;
+
+RarestEvictionPolicy::RarestEvictionPolicy(Ptr<UniformRandomVariable> rand)
+  : m_rand(rand)
+{
+}
+
+void
+RarestEvictionPolicy::insert(NameId id)
+{
+  if (m_index.emplace(id, m_ids.size()).second)
+    m_ids.push_back(id);
+}
+
+void
+RarestEvictionPolicy::access(NameId id)
+{
+}
+
+void
+RarestEvictionPolicy::erase(NameId id)
+{
+  auto it = m_index.find(id);
+  if (it == m_index.end())
+    return;
+
+  //Swap with the last id, so removal is constant time
+  size_t position = it->second;
+  m_ids[position] = m_ids.back();
+  m_index[m_ids[position]] = position;
+  m_ids.pop_back();
+  m_index.erase(id);
+}
+
+NameId
+RarestEvictionPolicy::victim()
+{
+  if (m_ids.empty())
+    return INVALID_NAME_ID;
+
+  NameId victim = INVALID_NAME_ID;
+  uint32_t victimHolders = 0;
+  for (uint32_t i = 0; i < SAMPLES; i++) {
+    NameId id = m_ids[m_rand->GetInteger(0, m_ids.size() - 1)];
+    uint32_t holders = NameTable::get().getHolders(id);
+    if (victim == INVALID_NAME_ID || holders > victimHolders) {
+      victim = id;
+      victimHolders = holders;
+    }
+  }
+  return victim;
+}
+
+} // namespace ndn
+} // namespace ns3
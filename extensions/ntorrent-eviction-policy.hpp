@@ -0,0 +1,155 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_EVICTION_POLICY_HPP
+#define NTORRENT_EVICTION_POLICY_HPP
+
+#include "ntorrent-name-table.hpp"
+
+#include "ns3/ptr.h"
+#include "ns3/random-variable-stream.h"
+
+#include <list>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Which data packet a capacity-bounded consumer store gives up first.
+ *
+ * The store tells the policy about every packet it stores (insert), serves (access) and
+ * drops (erase); victim() names the next packet to drop. Policies are created by name:
+ *
+ *   lru      least recently stored or served
+ *   lfu      least often served, least recently used among equals
+ *   rarest   kept: the packet held by the most nodes of the swarm goes first
+ */
+class EvictionPolicy
+{
+public:
+  virtual
+  ~EvictionPolicy() = default;
+
+  //nullptr if name is not a known policy
+  static std::unique_ptr<EvictionPolicy>
+  create(const std::string& name, Ptr<UniformRandomVariable> rand);
+
+  virtual void
+  insert(NameId id) = 0;
+
+  virtual void
+  access(NameId id) = 0;
+
+  virtual void
+  erase(NameId id) = 0;
+
+  //INVALID_NAME_ID if the policy tracks nothing
+  virtual NameId
+  victim() = 0;
+};
+
+class LruEvictionPolicy : public EvictionPolicy
+{
+public:
+  void
+  insert(NameId id) override;
+
+  void
+  access(NameId id) override;
+
+  void
+  erase(NameId id) override;
+
+  NameId
+  victim() override;
+
+private:
+  //Most recently used first
+  std::list<NameId> m_queue;
+  std::unordered_map<NameId, std::list<NameId>::iterator> m_index;
+};
+
+class LfuEvictionPolicy : public EvictionPolicy
+{
+public:
+  void
+  insert(NameId id) override;
+
+  void
+  access(NameId id) override;
+
+  void
+  erase(NameId id) override;
+
+  NameId
+  victim() override;
+
+private:
+  //(uses, last use, id): the first entry is the victim
+  typedef std::tuple<uint64_t, uint64_t, NameId> Key;
+  std::set<Key> m_order;
+  std::unordered_map<NameId, Key> m_index;
+  uint64_t m_clock = 0;
+};
+
+/*
+ * Replication counts come from the NameTable (see NameTable::getHolders), which every node
+ * of the process updates as it stores and drops packets: a global view no real peer has,
+ * standing in for what peers could learn from have maps. In an MPI run it only counts the
+ * nodes of the local rank. Scanning the store for the most common
+ * packet on every eviction would be linear, so the victim is the most common of SAMPLES
+ * random packets.
+ */
+class RarestEvictionPolicy : public EvictionPolicy
+{
+public:
+  static const uint32_t SAMPLES = 8;
+
+  explicit
+  RarestEvictionPolicy(Ptr<UniformRandomVariable> rand);
+
+  void
+  insert(NameId id) override;
+
+  void
+  access(NameId id) override;
+
+  void
+  erase(NameId id) override;
+
+  NameId
+  victim() override;
+
+private:
+  Ptr<UniformRandomVariable> m_rand;
+  std::vector<NameId> m_ids;
+  std::unordered_map<NameId, size_t> m_index;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_EVICTION_POLICY_HPP
@@ -19,11 +19,15 @@
  */
 #include "ntorrent-fwd-strategy.hpp"
 
-#include <boost/random/uniform_int_distribution.hpp>
+#include "core/logger.hpp"
+#include "ns3/ndnSIM/model/ndn-net-device-transport.hpp"
+#include "ns3/point-to-point-net-device.h"
+#include "ns3/queue.h"
 
-#include <ndn-cxx/util/random.hpp>
+#include <ndn-cxx/lp/tags.hpp>
 
-#include "core/logger.hpp"
+#include <limits>
+#include <set>
 
 #define MAX_SCORE 100
 
@@ -32,8 +36,18 @@ NFD_LOG_INIT("NTorrentStrategy");
 namespace nfd {
 namespace fw {
 
+std::ostream* NTorrentStrategy::s_traceStream = &std::cout;
+NTorrentStrategy::Granularity NTorrentStrategy::s_granularity = NTorrentStrategy::FACE;
+uint32_t NTorrentStrategy::s_congestionThreshold = 0;
+constexpr double NTorrentStrategy::CONGESTION_PENALTY;
+const uint64_t NTorrentStrategy::DATA_RANGE_SIZE;
+
+//Prefix statistics unused for this long are dropped by the Measurements table
+static const time::seconds MEASUREMENTS_LIFETIME(60);
+
 NTorrentStrategy::NTorrentStrategy(Forwarder& forwarder, const Name& name)
   : Strategy(forwarder)
+  , m_randomVariable(ns3::CreateObject<ns3::UniformRandomVariable>())
 {
   this->setInstanceName(makeInstanceName(name, getStrategyName()));
 }
@@ -42,6 +56,19 @@ NTorrentStrategy::~NTorrentStrategy()
 {
 }
 
+//Packets waiting in the queue of the point-to-point device under face (0 for other faces)
+static uint32_t
+getQueueLength(const Face& face)
+{
+  auto transport = dynamic_cast<const ns3::ndn::NetDeviceTransport*>(face.getTransport());
+  if (transport == nullptr)
+    return 0;
+  auto device = ns3::DynamicCast<ns3::PointToPointNetDevice>(transport->GetNetDevice());
+  if (device == nullptr)
+    return 0;
+  return device->GetQueue()->GetNPackets();
+}
+
 static bool
 canForwardToNextHop(const Face& inFace, shared_ptr<pit::Entry> pitEntry, const fib::NextHop& nexthop)
 {
@@ -62,15 +89,28 @@ NTorrentStrategy::afterReceiveInterest (const Face& inFace, const Interest& inte
 {
   NFD_LOG_TRACE("afterReceiveInterest");
   uint16_t face_id = inFace.getId();
-  Name interestName = interest.getName();
+  const Name& interestName = interest.getName();
   long int curr_timestamp = getTimestamp();
-  std::cout << curr_timestamp << ": ARI " << face_id << " " << interestName << std::endl;
+  if (s_traceStream != nullptr)
+    *s_traceStream << curr_timestamp << ": ARI " << face_id << " " << interestName << std::endl;
 
-  if (hasPendingOutRecords(*pitEntry)) {
-    // not a new Interest, don't forward
+  if (ns3::ndn::HaveMap::isAdvertisement(interestName)) {
+    onHaveAdvertisement(inFace, interest, pitEntry);
     return;
   }
 
+  //Same loss recovery as best-route2: a retransmission tries another path
+  switch (m_retxSuppression.decidePerPitEntry(*pitEntry)) {
+    case RetxSuppressionResult::NEW:
+      break;
+    case RetxSuppressionResult::FORWARD:
+      retryOnAnotherNextHop(inFace, interest, pitEntry);
+      return;
+    case RetxSuppressionResult::SUPPRESS:
+      NFD_LOG_DEBUG(interestName << " retransmitted too soon, suppressed");
+      return;
+  }
+
   //After you get a match, you might have multiple next hops. You pick the best one naively. Keep some score for next hop of the FIB entry.
   const fib::Entry& fibEntry = this->lookupFib(*pitEntry);
   const fib::NextHopList& nexthops = fibEntry.getNextHops();
@@ -81,26 +121,10 @@ NTorrentStrategy::afterReceiveInterest (const Face& inFace, const Interest& inte
     return;
   }
 
-  auto it = face_name_incoming_time.find(face_id);
-  name_incoming_time n;
-  //If there's no such face in the map, create an entry, store the interest name and arrival timestamp
-  if(it==face_name_incoming_time.end())
-  {
-      n.insert(std::make_pair(interestName, curr_timestamp));
-      face_name_incoming_time.insert(std::make_pair(face_id, n));
-  }
-  //If there's this face in the map, check if the interest name already exists...
-  else
-  {
-    n = it->second;
-    //auto _it = n.find(interestName);
-    //If it doesn't exist, create a new interestName-> arrival time mapping
-    //If it exists, update the latest arrival time
-    n.insert(std::make_pair(interestName, curr_timestamp));
-    it->second = n;
-    face_name_incoming_time.erase(face_id);
-    face_name_incoming_time.insert(std::make_pair(face_id, n));
-  }
+  //Store the interest name and arrival timestamp for this face (creating the face's entry if needed)
+  //If the name is already there, its first arrival time is kept
+  ns3::ndn::NameId interestId = ns3::ndn::NameTable::get().intern(interestName);
+  face_name_incoming_time[face_id].insert(std::make_pair(interestId, curr_timestamp));
 
   //Populate satisfaction rate
   auto f_it = face_satisfaction_rate.find(face_id);
@@ -119,12 +143,20 @@ NTorrentStrategy::afterReceiveInterest (const Face& inFace, const Interest& inte
       face_satisfaction_rate.insert(std::make_pair(face_id, std::make_pair(data_sent, interests_received)));
   }
   
+  //A neighbor that advertised the piece is one hop away, whatever the delay statistics say
+  Face* holder = findHolder(inFace, interestName, pitEntry);
+  if(holder != nullptr){
+      this->sendInterest(pitEntry, *holder, interest);
+      return;
+  }
+
+  const auto& faceDelays = getFaceDelays(interestName, ns3::ndn::NameTable::get().getType(interestId));
+
   //Pick one face at random if you have no information about delay
-  if(face_average_delay.size()==0){
+  if(faceDelays.size()==0){
       fib::NextHopList::const_iterator selected;
       do {
-        boost::random::uniform_int_distribution<> dist(0, nexthops.size() - 1);
-        const size_t randomIndex = dist(m_randomGenerator);
+        const size_t randomIndex = m_randomVariable->GetInteger(0, nexthops.size() - 1);
         
         uint64_t currentIndex = 0;
 
@@ -140,8 +172,15 @@ NTorrentStrategy::afterReceiveInterest (const Face& inFace, const Interest& inte
   //Otherwise, pick the face with the lowest delay
   else
   {
-      //sort the face_average_delay member based on the average delay, in ascending order
-      std::vector<std::pair<int, std::pair<int,int>>> elems(face_average_delay.begin(), face_average_delay.end());
+      //sort the delay statistics based on the average delay, in ascending order
+      std::vector<std::pair<int, std::pair<int,int>>> elems(faceDelays.begin(), faceDelays.end());
+      //Faces delivering congestion marks look slower than measured
+      for(auto& e : elems)
+      {
+          auto c = face_congestion.find(e.first);
+          if(c != face_congestion.end())
+              e.second.first = (int)(e.second.first * (1 + CONGESTION_PENALTY * c->second));
+      }
       std::sort(elems.begin(), elems.end(), compareDelay);
 
       for(auto i=elems.begin(); i!= elems.end(); i++)
@@ -156,18 +195,154 @@ NTorrentStrategy::afterReceiveInterest (const Face& inFace, const Interest& inte
   }
 }
 
+Name
+NTorrentStrategy::getMeasurementsPrefix(const Name& name, ndn_ntorrent::IoUtil::NAME_TYPE type)
+{
+  //Names are full names: the last component is the implicit digest
+  switch (s_granularity) {
+    case FACE:
+      break;
+    case TORRENT:
+      // /NTORRENT/<torrent>
+      return name.getPrefix(2);
+    case MANIFEST:
+      //A data packet falls under the name of its manifest
+      return type == ndn_ntorrent::IoUtil::DATA_PACKET ? name.getPrefix(-2) : name.getPrefix(-1);
+    case DATA_RANGE:
+      if (type != ndn_ntorrent::IoUtil::DATA_PACKET)
+        return name.getPrefix(-1);
+      return name.getPrefix(-2).appendNumber(name.get(-2).toSequenceNumber() / DATA_RANGE_SIZE);
+  }
+  return Name();
+}
+
+const std::unordered_map<int, std::pair<int,int>>&
+NTorrentStrategy::getFaceDelays(const Name& name, ndn_ntorrent::IoUtil::NAME_TYPE type)
+{
+  if (s_granularity == FACE || type == ndn_ntorrent::IoUtil::UNKNOWN)
+    return face_average_delay;
+
+  measurements::Entry* entry = this->getMeasurements().findExactMatch(getMeasurementsPrefix(name, type));
+  PrefixDelayInfo* info = entry != nullptr ? entry->getStrategyInfo<PrefixDelayInfo>() : nullptr;
+  if (info == nullptr || info->face_average_delay.empty())
+    return face_average_delay;
+
+  this->getMeasurements().extendLifetime(*entry, MEASUREMENTS_LIFETIME);
+  return info->face_average_delay;
+}
+
+void
+NTorrentStrategy::onHaveAdvertisement(const Face& inFace, const Interest& interest,
+                                      const shared_ptr<pit::Entry>& pitEntry)
+{
+  if (inFace.getScope() == ndn::nfd::FACE_SCOPE_LOCAL) {
+    for (Face& face : this->getFaceTable()) {
+      if (face.getScope() == ndn::nfd::FACE_SCOPE_NON_LOCAL)
+        this->sendInterest(pitEntry, face, interest);
+    }
+    return;
+  }
+
+  face_have_map[inFace.getId()] = ns3::ndn::HaveMap::decode(interest.getName());
+  this->rejectPendingInterest(pitEntry);
+}
+
+Face*
+NTorrentStrategy::findHolder(const Face& inFace, const Name& name, const shared_ptr<pit::Entry>& pitEntry)
+{
+  if (face_have_map.empty())
+    return nullptr;
+
+  uint64_t nameHash = ns3::ndn::HaveMap::hash(name);
+  std::vector<Face*> holders;
+  for (const auto& have : face_have_map) {
+    Face* face = getFace(have.first);
+    if (face != nullptr && have.second.contains(nameHash) && canForwardToNextHop(inFace, pitEntry, fib::NextHop(*face)))
+      holders.push_back(face);
+  }
+  if (holders.empty())
+    return nullptr;
+  return holders[m_randomVariable->GetInteger(0, holders.size() - 1)];
+}
+
+void
+NTorrentStrategy::retryOnAnotherNextHop(const Face& inFace, const Interest& interest,
+                                        const shared_ptr<pit::Entry>& pitEntry)
+{
+  const fib::NextHopList& nexthops = this->lookupFib(*pitEntry).getNextHops();
+  const auto& faceDelays = getFaceDelays(interest.getName(), ns3::ndn::classifyName(interest.getName()));
+  auto now = time::steady_clock::now();
+
+  //Unused next hops first, fastest first (faces without samples last); then the one used earliest
+  Face* best = nullptr;
+  bool bestUnused = false;
+  double bestDelay = 0;
+  time::steady_clock::TimePoint bestLastUsed;
+  for (const auto& nexthop : nexthops) {
+    Face& face = nexthop.getFace();
+    if (face.getId() == inFace.getId() || wouldViolateScope(inFace, interest, face))
+      continue;
+
+    auto outRecord = pitEntry->getOutRecord(face);
+    bool unused = outRecord == pitEntry->out_end() || outRecord->getExpiry() < now;
+    auto stats = faceDelays.find(face.getId());
+    double delay = stats != faceDelays.end() ? double(stats->second.first) / stats->second.second :
+                                               std::numeric_limits<double>::max();
+    time::steady_clock::TimePoint lastUsed = outRecord != pitEntry->out_end() ?
+                                             outRecord->getLastRenewed() : time::steady_clock::TimePoint::min();
+
+    bool better;
+    if (best == nullptr || unused != bestUnused)
+      better = best == nullptr || unused;
+    else if (unused)
+      better = delay < bestDelay;
+    else
+      better = lastUsed < bestLastUsed;
+
+    if (better) {
+      best = &face;
+      bestUnused = unused;
+      bestDelay = delay;
+      bestLastUsed = lastUsed;
+    }
+  }
+
+  if (best == nullptr) {
+    NFD_LOG_DEBUG(interest.getName() << " retransmitted, no other next hop");
+    return;
+  }
+  NFD_LOG_DEBUG(interest.getName() << " retransmitted to " << (bestUnused ? "unused" : "earliest used")
+                << " face " << best->getId());
+  this->sendInterest(pitEntry, *best, interest);
+}
+
 void
 NTorrentStrategy::beforeSatisfyInterest (const shared_ptr< pit::Entry > &pitEntry, const Face &inFace, const Data &data)
 {
   NFD_LOG_TRACE("beforeSatisfyInterest");
   uint16_t face_id = inFace.getId();
-  Name dataName = data.getFullName();
+  const Name& dataName = data.getFullName();
   long int curr_timestamp = getTimestamp();
   
-  ndn_ntorrent::IoUtil::NAME_TYPE dataType = ndn_ntorrent::IoUtil::findType(dataName);
+  //Torrent names were interned (and are classified once) when their Interest came through
+  ns3::ndn::NameTable& names = ns3::ndn::NameTable::get();
+  ns3::ndn::NameId dataId = names.find(dataName);
+  ndn_ntorrent::IoUtil::NAME_TYPE dataType = dataId != ns3::ndn::INVALID_NAME_ID ?
+                                             names.getType(dataId) : ns3::ndn::classifyName(dataName);
   if(dataType == ndn_ntorrent::IoUtil::UNKNOWN)
       return;
-  std::cout << curr_timestamp << ": BSI " << face_id << " " << dataName << std::endl;
+  if (s_traceStream != nullptr)
+    *s_traceStream << curr_timestamp << ": BSI " << face_id << " " << dataName << std::endl;
+
+  //Congestion upstream (the mark arrived with the Data)
+  auto mark = data.getTag<lp::CongestionMarkTag>();
+  bool marked = mark != nullptr && mark->get() > 0;
+  auto c_it = face_congestion.find(face_id);
+  if(marked || c_it != face_congestion.end())
+  {
+      double& congestion = face_congestion[face_id];
+      congestion = 0.875 * congestion + (marked ? 0.125 : 0.0);
+  }
   
   //Update satisfaction rate
   auto f_it = face_satisfaction_rate.find(face_id);
@@ -182,22 +357,19 @@ NTorrentStrategy::beforeSatisfyInterest (const shared_ptr< pit::Entry > &pitEntr
   }
   
   auto it = face_name_incoming_time.find(face_id);
-  name_incoming_time n;
   
   //Check if the face exists in the map, and if it does...
   if(it != face_name_incoming_time.end())
   {
-    
-    n = it->second;
-    //Look for the name in the unordered map 
-    auto it1 = n.find(dataName);
+    name_incoming_time& n = it->second;
+    //Look for the name in the unordered map (a name never interned was never recorded)
+    auto it1 = n.find(dataId);
     //if it exists, extract the timestamp and update the face_average_delay member
     //Delete it from the unordered map
     if(it1 != n.end())
     {
         long int old_timestamp = it1->second;
-        n.erase(dataName);
-        it->second = n;
+        n.erase(it1);
 
         int added_delay = (int)(curr_timestamp - old_timestamp);
 
@@ -217,6 +389,20 @@ NTorrentStrategy::beforeSatisfyInterest (const shared_ptr< pit::Entry > &pitEntr
         {
             face_average_delay.insert(std::make_pair(face_id, std::make_pair(added_delay, 1)));
         }
+
+        //Same sample, for the prefix the name falls under
+        if(s_granularity != FACE)
+        {
+            measurements::Entry* entry = this->getMeasurements().get(getMeasurementsPrefix(dataName, dataType));
+            if(entry != nullptr)
+            {
+                this->getMeasurements().extendLifetime(*entry, MEASUREMENTS_LIFETIME);
+                std::pair<int,int>& stats =
+                    entry->insertStrategyInfo<PrefixDelayInfo>().first->face_average_delay[face_id];
+                stats.first += added_delay;
+                stats.second += 1;
+            }
+        }
     }
   }	  
 }
@@ -245,8 +431,82 @@ NTorrentStrategy::afterReceiveData (const shared_ptr<pit::Entry>& pitEntry,
         const Face& inFace, const Data& data)
 {
   NFD_LOG_TRACE("afterReceiveData");
+  this->beforeSatisfyInterest(pitEntry, inFace, data);
+
+  //Same downstreams as sendDataToAll
+  std::set<const Face*> downstreams;
+  auto now = time::steady_clock::now();
+  for(const auto& inRecord : pitEntry->getInRecords())
+  {
+      if(inRecord.getExpiry() > now &&
+         (inRecord.getFace().getId() != inFace.getId() ||
+          inRecord.getFace().getLinkType() == ::ndn::nfd::LINK_TYPE_AD_HOC))
+          downstreams.insert(&inRecord.getFace());
+  }
+
+  //A mark from upstream already goes out to everyone. Otherwise only the faces whose queue is
+  //over the threshold get a marked copy: data itself is the Content Store's copy, a mark left
+  //on it would go out with every later cache hit.
+  auto mark = data.getTag<lp::CongestionMarkTag>();
+  bool marked = mark != nullptr && mark->get() > 0;
+  for(const Face* downstream : downstreams)
+  {
+      if(!marked && s_congestionThreshold > 0 && getQueueLength(*downstream) > s_congestionThreshold)
+      {
+          Data markedCopy(data);
+          markedCopy.setTag(make_shared<lp::CongestionMarkTag>(1));
+          this->sendData(pitEntry, markedCopy, *downstream);
+      }
+      else
+      {
+          this->sendData(pitEntry, data, *downstream);
+      }
+  }
 }
 
+ns3::ndn::MemoryUsageList
+NTorrentStrategy::getMemoryUsage() const
+{
+  using ns3::ndn::MemoryUsage;
+  using ns3::ndn::CONTAINER_NODE_BYTES;
+  ns3::ndn::MemoryUsageList usage;
+
+  MemoryUsage incoming{"face_name_incoming_time", 0, 0};
+  for (const auto& face : face_name_incoming_time) {
+    incoming.objects += face.second.size();
+    incoming.bytes += sizeof(face) + CONTAINER_NODE_BYTES +
+                      face.second.size() * (sizeof(name_incoming_time::value_type) + CONTAINER_NODE_BYTES);
+  }
+  usage.push_back(incoming);
+
+  uint64_t faceEntryBytes = sizeof(std::pair<int, std::pair<int,int>>) + CONTAINER_NODE_BYTES;
+  usage.push_back(MemoryUsage{"face_average_delay", face_average_delay.size(),
+                              face_average_delay.size() * faceEntryBytes});
+  usage.push_back(MemoryUsage{"face_satisfaction_rate", face_satisfaction_rate.size(),
+                              face_satisfaction_rate.size() * faceEntryBytes});
+
+  MemoryUsage nacked{"nackedname_nexthop", nackedname_nexthop.size(), 0};
+  for (const auto& n : nackedname_nexthop)
+    nacked.bytes += sizeof(n) + n.second.capacity() * sizeof(int) + CONTAINER_NODE_BYTES;
+  usage.push_back(nacked);
+
+  usage.push_back(MemoryUsage{"face_congestion", face_congestion.size(),
+                              face_congestion.size() * (sizeof(std::pair<int, double>) + CONTAINER_NODE_BYTES)});
+
+  MemoryUsage haveMaps{"face_have_map", face_have_map.size(), 0};
+  for (const auto& have : face_have_map)
+    haveMaps.bytes += sizeof(have) + have.second.getSizeInBytes() + CONTAINER_NODE_BYTES;
+  usage.push_back(haveMaps);
+
+  return usage;
+}
+
+int64_t
+NTorrentStrategy::AssignStreams(int64_t stream)
+{
+  m_randomVariable->SetStream(stream);
+  return 1;
+}
 
 const Name&
 NTorrentStrategy::getStrategyName()
@@ -29,17 +29,53 @@
 
 namespace ndn_ntorrent = ndn::ntorrent;
 
-#include <boost/random/mersenne_twister.hpp>
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
 #include "face/face.hpp"
 #include "fw/strategy.hpp"
 #include "fw/algorithm.hpp"
-#include <sys/time.h>
+#include "fw/retx-suppression-exponential.hpp"
+
+#include "ntorrent-have-map.hpp"
+#include "ntorrent-memory-usage.hpp"
+#include "ntorrent-name-table.hpp"
 
 namespace nfd {
 namespace fw {
 
 class NTorrentStrategy : public Strategy {
 public:
+  /* What the delay statistics used to pick a next hop are kept for:
+   *   FACE        one set for the node (every name), in face_average_delay
+   *   TORRENT     one set per torrent
+   *   MANIFEST    one set per file manifest (a torrent segment counts as one)
+   *   DATA_RANGE  one set per DATA_RANGE_SIZE consecutive data packets of a manifest
+   * Per prefix sets live in NFD's Measurements table and expire after MEASUREMENTS_LIFETIME
+   * without use; face_average_delay stays as the fallback for prefixes with no samples yet. */
+  enum Granularity {
+    FACE,
+    TORRENT,
+    MANIFEST,
+    DATA_RANGE
+  };
+
+  static const uint64_t DATA_RANGE_SIZE = 64;
+
+  /* Data forwarded while a downstream link's queue holds more than threshold packets is marked
+   * with a CongestionMarkTag (0 disables marking). Marks travel with the Data to the consumer;
+   * on the way, every strategy makes the upstream face they came from look slower. */
+  static void setCongestionThreshold(uint32_t threshold){
+    s_congestionThreshold = threshold;
+  }
+
+  /* Delay multiplier of a face always delivering marked Data is 1 + CONGESTION_PENALTY */
+  static constexpr double CONGESTION_PENALTY = 4.0;
+
+  static void setGranularity(Granularity granularity){
+    s_granularity = granularity;
+  }
+
+
   NTorrentStrategy(Forwarder& forwarder, const Name& name = getStrategyName());
 
   virtual ~NTorrentStrategy() override;
@@ -48,8 +84,6 @@ public:
   afterReceiveInterest (const Face& inFace, const Interest& interest,
                        const shared_ptr<pit::Entry>& pitEntry) override;
 
-  //TODO: Add afterReceiveData
-    
   virtual void
   beforeSatisfyInterest (const shared_ptr< pit::Entry > &pitEntry, 
                         const Face &inFace, const Data &data) override;
@@ -65,29 +99,42 @@ public:
   onDroppedInterest (const Face &outFace, const Interest &interest)
   override;
 
+  //Data satisfying a single PIT entry: downstreams behind a congested queue get a marked copy
   virtual void
   afterReceiveData (const shared_ptr<pit::Entry>& pitEntry,
-          const Face& inFace, const Data& data);
+          const Face& inFace, const Data& data) override;
   
   static const Name&
   getStrategyName();
 
+  /* Pin the strategy's random stream (next hop and holder choice); returns the streams used */
+  int64_t
+  AssignStreams(int64_t stream);
+
+  /* Objects and (estimated) bytes held by each of the strategy's tables */
+  ns3::ndn::MemoryUsageList
+  getMemoryUsage() const;
+
+  /* Where the per-packet ARI/BSI lines go (std::cout by default); nullptr disables them.
+   * Distributed runs point this at a per-rank file so ranks don't interleave their output. */
+  static void setTraceStream(std::ostream* os){
+    s_traceStream = os;
+  }
+
+  /* Simulated time in microseconds, so delay statistics do not depend on host load */
   static long int getTimestamp(){
-    struct timeval tp;
-    gettimeofday(&tp, NULL);
-    long int us = tp.tv_sec*1000000 + tp.tv_usec;
-    return us;
+    return ns3::Simulator::Now().GetMicroSeconds();
   }
 
   /* dump out everything from face_name_incoming_time */
-  static void dump_hash(std::string label, std::unordered_map<int,std::unordered_map<Name, long int>> face_name_incoming_time){  
+  static void dump_hash(std::string label, const std::unordered_map<int,std::unordered_map<ns3::ndn::NameId, long int>>& face_name_incoming_time){  
     std::cout << label;
   for(auto i=face_name_incoming_time.begin(); i!=face_name_incoming_time.end(); ++i)
   {
     std::cout << i->first << ": { ";
     for(auto j=i->second.begin(); j!=i->second.end(); ++j)
     {
-        std::cout << j->first << ": " << j->second << ", ";
+        std::cout << ns3::ndn::NameTable::get().getName(j->first) << ": " << j->second << ", ";
     }
     std::cout << "}, " << std::endl;
   }
@@ -104,15 +151,68 @@ public:
   }
 
 protected:
-  boost::random::mt19937 m_randomGenerator;
+  /* Delay statistics (face -> (total delay, samples)) kept at one prefix */
+  class PrefixDelayInfo : public StrategyInfo
+  {
+  public:
+    static constexpr int
+    getTypeId()
+    {
+      return 9100;
+    }
+
+    std::unordered_map<int, std::pair<int,int>> face_average_delay;
+  };
+
+  /* Measurements prefix of name at the current granularity (empty name for FACE) */
+  static Name
+  getMeasurementsPrefix(const Name& name, ndn_ntorrent::IoUtil::NAME_TYPE type);
+
+  /* Statistics to pick a next hop for name: its prefix's, or face_average_delay if it has none */
+  const std::unordered_map<int, std::pair<int,int>>&
+  getFaceDelays(const Name& name, ndn_ntorrent::IoUtil::NAME_TYPE type);
+
+  /* A consumer retransmission: forward it on the best next hop not tried yet for this PIT
+   * entry (by average delay), or the one tried longest ago, never back to inFace */
+  void
+  retryOnAnotherNextHop(const Face& inFace, const Interest& interest,
+                        const shared_ptr<pit::Entry>& pitEntry);
+
+  /* Have map advertisement: sent on to every neighbor when it comes from a local app,
+   * recorded for inFace and consumed when it comes from a neighbor */
+  void
+  onHaveAdvertisement(const Face& inFace, const Interest& interest,
+                      const shared_ptr<pit::Entry>& pitEntry);
+
+  /* A neighbor whose have map contains the name, nullptr if none does */
+  Face*
+  findHolder(const Face& inFace, const Name& name, const shared_ptr<pit::Entry>& pitEntry);
+
+protected:
+  //Retransmissions closer than the (exponentially growing) suppression interval are dropped
+  RetxSuppressionExponential m_retxSuppression;
+
+  //Drawn from RngSeedManager; scenarios give every node's strategy its own stream (AssignStreams)
+  ns3::Ptr<ns3::UniformRandomVariable> m_randomVariable;
 
-  typedef std::unordered_map<Name,long int> name_incoming_time;
+  //Names are interned (see NameTable): tables hold ids, not copies of names
+  typedef std::unordered_map<ns3::ndn::NameId,long int> name_incoming_time;
   std::unordered_map<int, name_incoming_time> face_name_incoming_time;
   
   std::unordered_map<int, std::pair<int,int>> face_average_delay;
   std::unordered_map<int, std::pair<int,int>> face_satisfaction_rate;
   
-  std::unordered_map<Name,std::vector<int>> nackedname_nexthop;
+  std::unordered_map<ns3::ndn::NameId,std::vector<int>> nackedname_nexthop;
+
+  //Moving average of the fraction of marked Data each upstream face delivered
+  std::unordered_map<int, double> face_congestion;
+
+  //Last have map advertised by the neighbor on each face
+  std::unordered_map<int, ns3::ndn::HaveMap> face_have_map;
+
+  static std::ostream* s_traceStream;
+  static Granularity s_granularity;
+  static uint32_t s_congestionThreshold;
 };
 
 } // namespace fw
@@ -0,0 +1,132 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-have-map.hpp"
+
+#include <cstring>
+
+namespace ns3 {
+namespace ndn {
+
+static const char NTORRENT_COMPONENT[] = "NTORRENT";
+static const char HAVE_COMPONENT[] = "have";
+
+static bool
+isComponent(const ::ndn::name::Component& component, const char* value, size_t size)
+{
+  return component.type() == ::ndn::tlv::GenericNameComponent && component.value_size() == size &&
+         std::memcmp(component.value(), value, size) == 0;
+}
+
+HaveMap::HaveMap(uint32_t bits, uint32_t hashes)
+  : m_bits((bits + 7) / 8, 0)
+  , m_hashes(hashes)
+  , m_count(0)
+{
+}
+
+uint64_t
+HaveMap::hash(const ::ndn::Name& name)
+{
+  uint64_t x = 0;
+  if (!name.empty() && name.get(-1).isImplicitSha256Digest()) {
+    const uint8_t* digest = name.get(-1).value();
+    for (int i = 0; i < 8; i++)
+      x = (x << 8) | digest[i];
+    return x;
+  }
+
+  //FNV-1a over the encoding, then splitmix64's finalizer to spread it
+  const ::ndn::Block& wire = name.wireEncode();
+  x = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < wire.size(); i++)
+    x = (x ^ wire.wire()[i]) * 0x100000001b3ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+uint32_t
+HaveMap::getBit(uint64_t nameHash, uint32_t hash) const
+{
+  //Double hashing over the two halves of the name's hash
+  uint32_t h1 = static_cast<uint32_t>(nameHash);
+  uint32_t h2 = static_cast<uint32_t>(nameHash >> 32) | 1;
+  return (h1 + hash * h2) % (m_bits.size() * 8);
+}
+
+void
+HaveMap::insert(uint64_t nameHash)
+{
+  if (m_bits.empty())
+    return;
+
+  for (uint32_t i = 0; i < m_hashes; i++) {
+    uint32_t bit = getBit(nameHash, i);
+    m_bits[bit / 8] |= 1 << (bit % 8);
+  }
+  m_count++;
+}
+
+bool
+HaveMap::contains(uint64_t nameHash) const
+{
+  if (m_bits.empty())
+    return false;
+
+  for (uint32_t i = 0; i < m_hashes; i++) {
+    uint32_t bit = getBit(nameHash, i);
+    if ((m_bits[bit / 8] & (1 << (bit % 8))) == 0)
+      return false;
+  }
+  return true;
+}
+
+::ndn::Name
+HaveMap::makeAdvertisement(uint32_t node, uint64_t seq) const
+{
+  ::ndn::Name name(std::string("/") + NTORRENT_COMPONENT + "/" + HAVE_COMPONENT);
+  name.appendNumber(node).appendNumber(seq);
+  name.append(m_bits.data(), m_bits.size());
+  return name;
+}
+
+bool
+HaveMap::isAdvertisement(const ::ndn::Name& name)
+{
+  return name.size() == 5 &&
+         isComponent(name.get(0), NTORRENT_COMPONENT, sizeof(NTORRENT_COMPONENT) - 1) &&
+         isComponent(name.get(1), HAVE_COMPONENT, sizeof(HAVE_COMPONENT) - 1);
+}
+
+HaveMap
+HaveMap::decode(const ::ndn::Name& name)
+{
+  HaveMap filter;
+  if (!isAdvertisement(name))
+    return filter;
+
+  const auto& bits = name.get(-1);
+  filter.m_bits.assign(bits.value(), bits.value() + bits.value_size());
+  return filter;
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,99 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_HAVE_MAP_HPP
+#define NTORRENT_HAVE_MAP_HPP
+
+#include <ndn-cxx/name.hpp>
+
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Bloom filter summarizing the pieces a node holds (its "have map").
+ *
+ * Filters hash the names themselves, not their NameTable ids: ids depend on the order names
+ * were interned in a process, so a filter built on one MPI rank (or in another run) would
+ * mean nothing to the node reading it. Full names end with their implicit digest, which is
+ * already a uniform hash and costs nothing to take. A node advertises its filter to its
+ * neighbors with an Interest named
+ *
+ *   /NTORRENT/have/<node id>/<advertisement seq>/<filter bits>
+ *
+ * which the neighbors' NTorrentStrategy records for the face it arrived on and consumes.
+ * The name classifies as UNKNOWN, so apps and tracers ignore it.
+ */
+class HaveMap
+{
+public:
+  explicit
+  HaveMap(uint32_t bits = 0, uint32_t hashes = 3);
+
+  //Where name falls in every filter: its implicit digest if it has one, else a hash of its TLV
+  static uint64_t
+  hash(const ::ndn::Name& name);
+
+  void
+  insert(uint64_t nameHash);
+
+  //False positives are possible, false negatives are not
+  bool
+  contains(uint64_t nameHash) const;
+
+  //Names inserted (decoded filters don't know theirs)
+  size_t
+  size() const
+  {
+    return m_count;
+  }
+
+  size_t
+  getSizeInBytes() const
+  {
+    return m_bits.size();
+  }
+
+  //Name of the advertisement of this filter by node
+  ::ndn::Name
+  makeAdvertisement(uint32_t node, uint64_t seq) const;
+
+  static bool
+  isAdvertisement(const ::ndn::Name& name);
+
+  //The filter carried by an advertisement name (an empty filter if it isn't one)
+  static HaveMap
+  decode(const ::ndn::Name& name);
+
+private:
+  uint32_t
+  getBit(uint64_t nameHash, uint32_t hash) const;
+
+private:
+  std::vector<uint8_t> m_bits;
+  uint32_t m_hashes;
+  size_t m_count;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_HAVE_MAP_HPP
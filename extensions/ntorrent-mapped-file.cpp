@@ -0,0 +1,85 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-mapped-file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3 {
+namespace ndn {
+
+MappedFile::MappedFile()
+  : m_data(nullptr)
+  , m_size(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool
+MappedFile::open(const std::string& path)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  //mmap() refuses empty mappings; an empty file is simply open with no data
+  void* data = nullptr;
+  if (st.st_size > 0) {
+    data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      return false;
+    }
+  }
+  ::close(fd);
+
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = st.st_size;
+  m_path = path;
+  return true;
+}
+
+void
+MappedFile::close()
+{
+  if (m_data != nullptr)
+    ::munmap(const_cast<uint8_t*>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+  m_path.clear();
+}
+
+} // namespace ndn
+} // namespace ns3
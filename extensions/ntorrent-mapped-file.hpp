@@ -0,0 +1,92 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_MAPPED_FILE_HPP
+#define NTORRENT_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Read-only memory map of a whole file.
+ *
+ * Pages are loaded by the OS as they are touched, so mapping a large file costs nothing
+ * until its bytes are read, and clean pages can be dropped again under memory pressure.
+ */
+class MappedFile
+{
+public:
+  MappedFile();
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile&
+  operator=(const MappedFile&) = delete;
+
+  /*
+   * @brief Map path, replacing any previous mapping
+   * @return false if the file cannot be opened or mapped
+   */
+  bool
+  open(const std::string& path);
+
+  void
+  close();
+
+  bool
+  isOpen() const
+  {
+    return m_data != nullptr || (m_size == 0 && !m_path.empty());
+  }
+
+  const uint8_t*
+  data() const
+  {
+    return m_data;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  const std::string&
+  path() const
+  {
+    return m_path;
+  }
+
+private:
+  const uint8_t* m_data;
+  size_t m_size;
+  std::string m_path;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_MAPPED_FILE_HPP
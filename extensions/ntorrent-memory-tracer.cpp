@@ -0,0 +1,170 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-memory-tracer.hpp"
+#include "ntorrent-consumer-app.hpp"
+#include "ntorrent-producer-app.hpp"
+#include "ntorrent-fwd-strategy.hpp"
+#include "ntorrent-name-table.hpp"
+
+#include "ns3/node-list.h"
+#include "ns3/simulator.h"
+
+NS_LOG_COMPONENT_DEFINE("NTorrentMemoryTracer");
+
+namespace ns3 {
+namespace ndn {
+
+std::shared_ptr<std::ofstream> NTorrentMemoryTracer::s_os;
+NodeContainer NTorrentMemoryTracer::s_nodes;
+Time NTorrentMemoryTracer::s_period;
+EventId NTorrentMemoryTracer::s_reportEvent;
+bool NTorrentMemoryTracer::s_destroyScheduled = false;
+
+static void
+writeUsage(std::ostream& os, const std::string& node, const std::string& event,
+           const std::string& component, const MemoryUsageList& usage)
+{
+  for (const auto& u : usage) {
+    os << Simulator::Now().ToDouble(Time::S) << "\t" << node << "\t" << event << "\t"
+       << component << "\t" << u.store << "\t" << u.objects << "\t" << u.bytes << "\n";
+  }
+}
+
+static MemoryUsageList
+forwarderUsage(nfd::Forwarder& forwarder)
+{
+  MemoryUsageList usage;
+
+  MemoryUsage fib{"Fib", 0, 0};
+  for (const nfd::fib::Entry& entry : forwarder.getFib()) {
+    fib.objects++;
+    fib.bytes += sizeof(entry) + estimateBytes(entry.getPrefix()) +
+                 entry.getNextHops().size() * sizeof(nfd::fib::NextHop);
+  }
+  usage.push_back(fib);
+
+  MemoryUsage pit{"Pit", 0, 0};
+  for (const nfd::pit::Entry& entry : forwarder.getPit()) {
+    pit.objects++;
+    pit.bytes += sizeof(entry) + entry.getInterest().wireEncode().size() +
+                 entry.getInRecords().size() * (sizeof(nfd::pit::InRecord) + CONTAINER_NODE_BYTES) +
+                 entry.getOutRecords().size() * (sizeof(nfd::pit::OutRecord) + CONTAINER_NODE_BYTES);
+  }
+  usage.push_back(pit);
+
+  MemoryUsage cs{"Cs", 0, 0};
+  for (const nfd::cs::Entry& entry : forwarder.getCs()) {
+    cs.objects++;
+    cs.bytes += sizeof(entry) + CONTAINER_NODE_BYTES + estimateBytes(entry.getData());
+  }
+  usage.push_back(cs);
+
+  return usage;
+}
+
+void
+NTorrentMemoryTracer::InstallAll(const std::string& file, Time period)
+{
+  Install(NodeContainer::GetGlobal(), file, period);
+}
+
+void
+NTorrentMemoryTracer::Install(const NodeContainer& nodes, const std::string& file, Time period)
+{
+  //Only one trace at a time: drop the previous one and its pending report
+  Simulator::Cancel(s_reportEvent);
+  s_os.reset();
+
+  s_os = std::make_shared<std::ofstream>(file.c_str());
+  if (!s_os->is_open()) {
+    NS_LOG_ERROR("Trace file " << file << " cannot be opened for writing. Tracing disabled");
+    s_os.reset();
+    return;
+  }
+
+  *s_os << "Time\tNode\tEvent\tComponent\tStore\tObjects\tBytes\n";
+  s_nodes = nodes;
+  s_period = period;
+  s_reportEvent = Simulator::Schedule(s_period, &NTorrentMemoryTracer::PeriodicReport);
+
+  //The trace of one simulation must not leak into the next one
+  if (!s_destroyScheduled) {
+    Simulator::ScheduleDestroy(&NTorrentMemoryTracer::Destroy);
+    s_destroyScheduled = true;
+  }
+}
+
+void
+NTorrentMemoryTracer::PeriodicReport()
+{
+  for (auto it = s_nodes.Begin(); it != s_nodes.End(); ++it)
+    ReportNode(*it, "periodic");
+  //Names are shared by all nodes
+  writeUsage(*s_os, "*", "periodic", "NameTable", NameTable::get().getMemoryUsage());
+  s_os->flush();
+  s_reportEvent = Simulator::Schedule(s_period, &NTorrentMemoryTracer::PeriodicReport);
+}
+
+void
+NTorrentMemoryTracer::Destroy()
+{
+  Simulator::Cancel(s_reportEvent);
+  if (s_os != nullptr)
+    s_os->flush();
+  s_os.reset();
+  s_nodes = NodeContainer();
+  s_period = Time();
+  //Destroy events run once, the next Install schedules its own
+  s_destroyScheduled = false;
+}
+
+void
+NTorrentMemoryTracer::ReportNode(Ptr<Node> node, const std::string& event)
+{
+  if (s_os == nullptr)
+    return;
+
+  std::string id = std::to_string(node->GetId());
+  for (uint32_t i = 0; i < node->GetNApplications(); i++) {
+    Ptr<Application> app = node->GetApplication(i);
+    if (Ptr<NTorrentConsumerApp> consumer = DynamicCast<NTorrentConsumerApp>(app))
+      writeUsage(*s_os, id, event, "NTorrentConsumerApp", consumer->getMemoryUsage());
+    else if (Ptr<NTorrentProducerApp> producer = DynamicCast<NTorrentProducerApp>(app))
+      writeUsage(*s_os, id, event, "NTorrentProducerApp", producer->getMemoryUsage());
+  }
+
+  Ptr<L3Protocol> l3 = node->GetObject<L3Protocol>();
+  if (l3 == nullptr)
+    return;
+
+  nfd::Forwarder& forwarder = *l3->getForwarder();
+  for (const nfd::strategy_choice::Entry& entry : forwarder.getStrategyChoice()) {
+    const nfd::fw::NTorrentStrategy* strategy =
+      dynamic_cast<const nfd::fw::NTorrentStrategy*>(&entry.getStrategy());
+    if (strategy != nullptr)
+      writeUsage(*s_os, id, event, "NTorrentStrategy", strategy->getMemoryUsage());
+  }
+
+  writeUsage(*s_os, id, event, "Forwarder", forwarderUsage(forwarder));
+}
+
+} // namespace ndn
+} // namespace ns3
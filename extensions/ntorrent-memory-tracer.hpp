@@ -0,0 +1,83 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_MEMORY_TRACER_HPP
+#define NTORRENT_MEMORY_TRACER_HPP
+
+#include "ns3/ndnSIM-module.h"
+#include "ns3/event-id.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+
+#include <fstream>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Periodic per-node memory report.
+ *
+ * For every traced node, writes one line per store: each NTorrent app's stores, each
+ * NTorrentStrategy table, and the node's FIB, PIT and CS. Apps also write a report for
+ * their node when they stop. Output (tab separated, like L3RateTracer):
+ *
+ *     Time  Node  Event  Component  Store  Objects  Bytes
+ *
+ * Usage (in the scenario, before Simulator::Run):
+ *
+ *     NTorrentMemoryTracer::InstallAll("memory.txt", Seconds(10));
+ *
+ * Installing again replaces the previous trace. The trace is closed at Simulator::Destroy.
+ */
+class NTorrentMemoryTracer
+{
+public:
+  static void
+  InstallAll(const std::string& file, Time period);
+
+  static void
+  Install(const NodeContainer& nodes, const std::string& file, Time period);
+
+  /*
+   * @brief Write a report for a single node now, tagged with event.
+   * Does nothing if no tracer has been installed.
+   */
+  static void
+  ReportNode(Ptr<Node> node, const std::string& event);
+
+private:
+  static void
+  PeriodicReport();
+
+  static void
+  Destroy();
+
+private:
+  static std::shared_ptr<std::ofstream> s_os;
+  static NodeContainer s_nodes;
+  static Time s_period;
+  static EventId s_reportEvent;
+  static bool s_destroyScheduled;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_MEMORY_TRACER_HPP
@@ -0,0 +1,78 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_MEMORY_USAGE_HPP
+#define NTORRENT_MEMORY_USAGE_HPP
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/name.hpp>
+
+#include <string>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Size of one store (a vector, a table...) held by an app or a strategy.
+ *
+ * Bytes are estimates: the wire size of the names/packets held plus the size of the
+ * objects and container nodes holding them. They are meant for sizing experiments and
+ * spotting growth, not for exact accounting.
+ */
+struct MemoryUsage
+{
+  std::string store;
+  uint64_t objects;
+  uint64_t bytes;
+};
+
+typedef std::vector<MemoryUsage> MemoryUsageList;
+
+//Per-element overhead of a node based container (unordered_map, list...)
+const uint64_t CONTAINER_NODE_BYTES = 2 * sizeof(void*);
+
+inline uint64_t
+estimateBytes(const ::ndn::Name& name)
+{
+  return sizeof(::ndn::Name) + name.wireEncode().size();
+}
+
+inline uint64_t
+estimateBytes(const ::ndn::Data& data)
+{
+  return sizeof(::ndn::Data) + data.wireEncode().size();
+}
+
+//Usage of a vector of Data (or subclasses of Data)
+template<typename Container>
+MemoryUsage
+dataStoreUsage(const std::string& store, const Container& packets)
+{
+  MemoryUsage usage{store, packets.size(), 0};
+  for (const auto& p : packets)
+    usage.bytes += estimateBytes(p);
+  return usage;
+}
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_MEMORY_USAGE_HPP
@@ -0,0 +1,74 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_NAME_CLASSIFIER_HPP
+#define NTORRENT_NAME_CLASSIFIER_HPP
+
+#include <ndn-cxx/name.hpp>
+
+#include "src/util/io-util.hpp"
+
+#include <cstring>
+
+namespace ndn_ntorrent = ndn::ntorrent;
+
+namespace ns3 {
+namespace ndn {
+
+static const char TORRENT_FILE_COMPONENT[] = "torrent-file";
+
+inline bool
+isTorrentFileComponent(const ::ndn::name::Component& component)
+{
+  return component.type() == ::ndn::tlv::GenericNameComponent &&
+         component.value_size() == sizeof(TORRENT_FILE_COMPONENT) - 1 &&
+         std::memcmp(component.value(), TORRENT_FILE_COMPONENT, sizeof(TORRENT_FILE_COMPONENT) - 1) == 0;
+}
+
+/*
+ * @brief Type of an nTorrent full name, with the same rules as IoUtil::findType:
+ *
+ *   torrent file segment   "torrent-file" second or third to last
+ *   data packet            second and third to last are sequence numbers
+ *   file manifest          only the second to last is a sequence number
+ *
+ * Components are compared as encoded (TLV type, length and value bytes), so no string is
+ * ever built. Names shorter than three components are UNKNOWN.
+ */
+inline ndn_ntorrent::IoUtil::NAME_TYPE
+classifyName(const ::ndn::Name& name)
+{
+  if (name.size() < 3)
+    return ndn_ntorrent::IoUtil::UNKNOWN;
+
+  const auto& second = name.get(-2);
+  const auto& third = name.get(-3);
+
+  if (isTorrentFileComponent(second) || isTorrentFileComponent(third))
+    return ndn_ntorrent::IoUtil::TORRENT_FILE;
+  if (!second.isSequenceNumber())
+    return ndn_ntorrent::IoUtil::UNKNOWN;
+  return third.isSequenceNumber() ? ndn_ntorrent::IoUtil::DATA_PACKET : ndn_ntorrent::IoUtil::FILE_MANIFEST;
+}
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_NAME_CLASSIFIER_HPP
@@ -0,0 +1,70 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-name-table.hpp"
+
+#include "ns3/simulator.h"
+
+namespace ns3 {
+namespace ndn {
+
+NameTable&
+NameTable::get()
+{
+  static NameTable table;
+  return table;
+}
+
+NameId
+NameTable::intern(const ::ndn::Name& name)
+{
+  auto inserted = m_ids.emplace(name, static_cast<NameId>(m_names.size()));
+  if (inserted.second) {
+    m_names.push_back(Entry{&inserted.first->first, ndn_ntorrent::IoUtil::UNKNOWN, false,
+                            INVALID_NAME_ID, 0, 0});
+
+    //Names of one simulation mean nothing to the next one
+    if (!m_clearScheduled) {
+      Simulator::ScheduleDestroy(&NameTable::clear, this);
+      m_clearScheduled = true;
+    }
+  }
+  return inserted.first->second;
+}
+
+void
+NameTable::clear()
+{
+  m_ids.clear();
+  m_names.clear();
+  m_clearScheduled = false;
+}
+
+MemoryUsageList
+NameTable::getMemoryUsage() const
+{
+  MemoryUsage names{"names", m_names.size(), 0};
+  for (const auto& entry : m_ids)
+    names.bytes += estimateBytes(entry.first) + sizeof(entry) + CONTAINER_NODE_BYTES + sizeof(Entry);
+  return MemoryUsageList{names};
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,158 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_NAME_TABLE_HPP
+#define NTORRENT_NAME_TABLE_HPP
+
+#include "ntorrent-memory-usage.hpp"
+#include "ntorrent-name-classifier.hpp"
+
+#include <ndn-cxx/name.hpp>
+
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+typedef uint32_t NameId;
+
+const NameId INVALID_NAME_ID = std::numeric_limits<NameId>::max();
+
+/*
+ * @brief Dense ids for the names of a simulation.
+ *
+ * A name is hashed once, when a packet enters an app or a strategy callback; stores and
+ * tables then key on its id, so nodes share a single copy of every name instead of one per
+ * table, and lookups hash a 32-bit integer. Ids are handed out in order of first use and are
+ * valid until Simulator::Destroy, which clears the table.
+ */
+class NameTable
+{
+public:
+  static NameTable&
+  get();
+
+  //Id of name, allocating one the first time the name is seen
+  NameId
+  intern(const ::ndn::Name& name);
+
+  //Id of name, or INVALID_NAME_ID if it was never interned
+  NameId
+  find(const ::ndn::Name& name) const
+  {
+    auto it = m_ids.find(name);
+    return it == m_ids.end() ? INVALID_NAME_ID : it->second;
+  }
+
+  const ::ndn::Name&
+  getName(NameId id) const
+  {
+    return *m_names.at(id).name;
+  }
+
+  //classifyName() of the name, computed the first time it is asked for
+  ndn_ntorrent::IoUtil::NAME_TYPE
+  getType(NameId id)
+  {
+    Entry& entry = m_names.at(id);
+    if (!entry.classified) {
+      entry.type = classifyName(*entry.name);
+      entry.classified = true;
+    }
+    return entry.type;
+  }
+
+  /*
+   * @brief Record that name id is entry `piece` of the catalog (torrent segment or manifest)
+   *        with id `catalog`. The torrent is the same on every node, so this is shared; the
+   *        first catalog listing a name wins.
+   */
+  void
+  setPiece(NameId id, NameId catalog, uint32_t piece)
+  {
+    Entry& entry = m_names.at(id);
+    if (entry.catalog == INVALID_NAME_ID) {
+      entry.catalog = catalog;
+      entry.piece = piece;
+    }
+  }
+
+  //Catalog listing name id (INVALID_NAME_ID if none is known yet) and its index in it
+  NameId
+  getCatalog(NameId id, uint32_t& piece) const
+  {
+    const Entry& entry = m_names.at(id);
+    piece = entry.piece;
+    return entry.catalog;
+  }
+
+  //Nodes of this process holding name id in their store, kept up to date by the consumers as they
+  //store/evict. A simulator-wide count no peer could know (and per rank in an MPI run), not
+  //something learnt from the swarm.
+  void
+  addHolders(NameId id, int32_t count)
+  {
+    m_names.at(id).holders += count;
+  }
+
+  uint32_t
+  getHolders(NameId id) const
+  {
+    return m_names.at(id).holders;
+  }
+
+  size_t
+  size() const
+  {
+    return m_names.size();
+  }
+
+  void
+  clear();
+
+  MemoryUsageList
+  getMemoryUsage() const;
+
+private:
+  NameTable() = default;
+
+private:
+  struct Entry
+  {
+    //Key in m_ids, which never moves once inserted
+    const ::ndn::Name* name;
+    ndn_ntorrent::IoUtil::NAME_TYPE type;
+    bool classified;
+    NameId catalog;
+    uint32_t piece;
+    uint32_t holders;
+  };
+
+  std::unordered_map< ::ndn::Name, NameId> m_ids;
+  std::vector<Entry> m_names;
+  bool m_clearScheduled = false;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_NAME_TABLE_HPP
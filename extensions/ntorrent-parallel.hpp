@@ -0,0 +1,71 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_PARALLEL_HPP
+#define NTORRENT_PARALLEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Call function(i) for every i in [0, count) on a pool of threads.
+ *
+ * Meant for setup work that runs before the simulation starts (hashing torrents), never for
+ * anything touching the simulator. Items are handed out one at a time, so uneven items
+ * balance themselves; function must only write state owned by item i, which keeps results
+ * identical to a sequential loop. threads == 0 uses every core.
+ */
+template<typename Function>
+void
+parallelFor(size_t count, const Function& function, size_t threads = 0)
+{
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = std::min(threads, count);
+
+  if (threads <= 1) {
+    for (size_t i = 0; i < count; i++)
+      function(i);
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&] {
+    for (size_t i = next++; i < count; i = next++)
+      function(i);
+  };
+
+  std::vector<std::thread> pool;
+  for (size_t t = 1; t < threads; t++)
+    pool.emplace_back(worker);
+  worker();
+  for (auto& thread : pool)
+    thread.join();
+}
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_PARALLEL_HPP
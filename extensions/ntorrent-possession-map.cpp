@@ -0,0 +1,110 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-possession-map.hpp"
+
+namespace ns3 {
+namespace ndn {
+
+void
+PossessionMap::addCatalog(NameId catalog, const std::vector< ::ndn::Name>& names)
+{
+  auto inserted = m_bitfields.emplace(catalog, std::vector<bool>());
+  if (!inserted.second)
+    return;
+
+  std::vector<bool>& bits = inserted.first->second;
+  bits.resize(names.size(), false);
+  for (uint32_t i = 0; i < names.size(); i++) {
+    NameId id = NameTable::get().intern(names[i]);
+    NameTable::get().setPiece(id, catalog, i);
+
+    uint32_t piece;
+    if (NameTable::get().getCatalog(id, piece) == catalog && m_unlisted.erase(id) > 0)
+      bits[piece] = true;
+  }
+}
+
+std::vector<bool>*
+PossessionMap::findBit(NameId id, uint32_t& piece)
+{
+  NameId catalog = NameTable::get().getCatalog(id, piece);
+  if (catalog == INVALID_NAME_ID)
+    return nullptr;
+
+  auto it = m_bitfields.find(catalog);
+  return it == m_bitfields.end() ? nullptr : &it->second;
+}
+
+bool
+PossessionMap::has(NameId id) const
+{
+  if (id == INVALID_NAME_ID)
+    return false;
+
+  uint32_t piece;
+  const std::vector<bool>* bits = findBit(id, piece);
+  return bits != nullptr ? (*bits)[piece] : m_unlisted.count(id) > 0;
+}
+
+bool
+PossessionMap::insert(NameId id)
+{
+  uint32_t piece;
+  std::vector<bool>* bits = findBit(id, piece);
+  if (bits == nullptr) {
+    if (!m_unlisted.insert(id).second)
+      return false;
+  }
+  else {
+    if ((*bits)[piece])
+      return false;
+    (*bits)[piece] = true;
+  }
+  m_count++;
+  return true;
+}
+
+void
+PossessionMap::erase(NameId id)
+{
+  uint32_t piece;
+  std::vector<bool>* bits = findBit(id, piece);
+  if (bits == nullptr) {
+    m_count -= m_unlisted.erase(id);
+  }
+  else if ((*bits)[piece]) {
+    (*bits)[piece] = false;
+    m_count--;
+  }
+}
+
+MemoryUsage
+PossessionMap::getMemoryUsage(const std::string& store) const
+{
+  MemoryUsage usage{store, m_count, 0};
+  for (const auto& bitfield : m_bitfields)
+    usage.bytes += sizeof(bitfield) + CONTAINER_NODE_BYTES + (bitfield.second.size() + 7) / 8;
+  usage.bytes += m_unlisted.size() * (sizeof(NameId) + CONTAINER_NODE_BYTES);
+  return usage;
+}
+
+} // namespace ndn
+} // namespace ns3
@@ -0,0 +1,94 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_POSSESSION_MAP_HPP
+#define NTORRENT_POSSESSION_MAP_HPP
+
+#include "ntorrent-memory-usage.hpp"
+#include "ntorrent-name-table.hpp"
+
+#include <ndn-cxx/name.hpp>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Pieces of the torrent a node holds: one bit per catalog entry.
+ *
+ * Every torrent segment and manifest gets a bitfield with one bit per name of its catalog,
+ * so holding a data packet costs a bit instead of a set entry and checking for a duplicate
+ * is a bit test. The position of a name in its catalog is the same on every node and is
+ * kept once, in the NameTable. Names no known catalog lists (the initial segment, index
+ * segments, a manifest arriving before the segment listing it) are kept in a set until
+ * their catalog is added.
+ */
+class PossessionMap
+{
+public:
+  //The catalog with id `catalog` (a torrent segment or manifest this node holds) lists names
+  void
+  addCatalog(NameId catalog, const std::vector< ::ndn::Name>& names);
+
+  bool
+  has(NameId id) const;
+
+  //Mark id as held; false if it already was
+  bool
+  insert(NameId id);
+
+  //Mark id as no longer held (evicted)
+  void
+  erase(NameId id);
+
+  //Pieces held
+  size_t
+  size() const
+  {
+    return m_count;
+  }
+
+  MemoryUsage
+  getMemoryUsage(const std::string& store) const;
+
+private:
+  //Bitfield (and bit) of id on this node, nullptr if this node has no catalog listing id
+  std::vector<bool>*
+  findBit(NameId id, uint32_t& piece);
+
+  const std::vector<bool>*
+  findBit(NameId id, uint32_t& piece) const
+  {
+    return const_cast<PossessionMap*>(this)->findBit(id, piece);
+  }
+
+private:
+  std::unordered_map<NameId, std::vector<bool>> m_bitfields;
+  std::unordered_set<NameId> m_unlisted;
+  size_t m_count = 0;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_POSSESSION_MAP_HPP
@@ -19,6 +19,17 @@
  */
 
 #include "ntorrent-producer-app.hpp"
+#include "ntorrent-memory-tracer.hpp"
+#include "ntorrent-routing.hpp"
+#include "ntorrent-torrent-generator.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <set>
+
+namespace fs = boost::filesystem;
 
 NS_LOG_COMPONENT_DEFINE("NTorrentProducerApp");
 
@@ -31,7 +42,7 @@ TypeId
 NTorrentProducerApp::GetTypeId(void)
 {
     static TypeId tid = TypeId("NTorrentProducerApp")
-      .SetParent<Application>()
+      .SetParent<App>()
       .AddConstructor<NTorrentProducerApp>()
       .AddAttribute("Prefix", "Prefix, for which producer has the data", StringValue("/"),
                     MakeNameAccessor(&NTorrentProducerApp::m_prefix), MakeNameChecker())
@@ -44,11 +55,39 @@ NTorrentProducerApp::GetTypeId(void)
       .AddAttribute("PayloadSize", "Virtual payload size for Content packets", IntegerValue(1024),
               MakeIntegerAccessor(&NTorrentProducerApp::m_virtualPayloadSize),
               MakeIntegerChecker<uint32_t>())
+      .AddAttribute("ImageDirectory", "Directory caching pre-encoded torrent images (empty: no image)",
+              StringValue(""),
+              MakeStringAccessor(&NTorrentProducerApp::m_imageDirectory), MakeStringChecker())
+      .AddAttribute("VirtualFiles", "Seed a synthetic torrent with this many files (0: use DUMMY_FILE_PATH)",
+              IntegerValue(0), MakeIntegerAccessor(&NTorrentProducerApp::m_virtualFiles),
+              MakeIntegerChecker<uint32_t>())
+      .AddAttribute("VirtualPacketsPerFile", "Packets (of PayloadSize bytes) per synthetic file",
+              IntegerValue(1024), MakeIntegerAccessor(&NTorrentProducerApp::m_virtualPacketsPerFile),
+              MakeIntegerChecker<uint32_t>())
+      .AddAttribute("BundleSize", "Packets per Data in the synthetic torrent, 1: no bundling (ignored for real files: raise dataPacketSize)",
+              IntegerValue(1), MakeIntegerAccessor(&NTorrentProducerApp::m_virtualBundleSize),
+              MakeIntegerChecker<uint32_t>(1))
+      .AddAttribute("OnDemandData", "Keep only torrent segments and manifests in memory, "
+              "build data packets from a memory map of the source files when requested",
+              BooleanValue(false), MakeBooleanAccessor(&NTorrentProducerApp::m_onDemandData),
+              MakeBooleanChecker())
+      .AddAttribute("ServedCacheSize", "Number of recently served data packets kept in on-demand mode",
+              IntegerValue(64), MakeIntegerAccessor(&NTorrentProducerApp::m_servedCacheSize),
+              MakeIntegerChecker<uint32_t>())
+      .AddAttribute("TorrentIndex", "Serve the index listing all torrent segments and manifests",
+              BooleanValue(true), MakeBooleanAccessor(&NTorrentProducerApp::m_serveTorrentIndex),
+              MakeBooleanChecker())
+      .AddAttribute("UploadRate", "Upload budget shared fairly by the downstream faces (0: unlimited)",
+              StringValue("0bps"), MakeDataRateAccessor(&NTorrentProducerApp::m_uploadRate),
+              MakeDataRateChecker())
+      .AddAttribute("UploadQueue", "Responses queued per downstream face when UploadRate is set",
+              IntegerValue(64), MakeIntegerAccessor(&NTorrentProducerApp::m_uploadQueue),
+              MakeIntegerChecker<uint32_t>(1))
       .AddAttribute("Freshness", "Freshness of data packets, if 0, then unlimited freshness",
               TimeValue(Seconds(0)), MakeTimeAccessor(&NTorrentProducerApp::m_freshness),
               MakeTimeChecker())
       .AddAttribute("Signature",
-              "Fake signature, 0 valid signature (default), other values application-specific",
+              "Fake signature of virtual packets, applied once when they are generated",
               IntegerValue(0), MakeIntegerAccessor(&NTorrentProducerApp::m_signature),
               MakeIntegerChecker<uint32_t>())
       .AddAttribute("KeyLocator",
@@ -59,6 +98,8 @@ NTorrentProducerApp::GetTypeId(void)
 }
 
 NTorrentProducerApp::NTorrentProducerApp()
+  : m_residentDataPackets(0)
+  , m_uploads([this] (uint64_t, const std::shared_ptr<const Data>& data) { SendData(data); })
 {
 }
 
@@ -71,36 +112,44 @@ NTorrentProducerApp::StartApplication()
 {
     App::StartApplication();
     ndn::FibHelper::AddRoute(GetNode(), "/", m_face, 0);
+    m_uploads.setRate(m_uploadRate);
+    m_uploads.setQueueLimit(m_uploadQueue);
     generateTorrentFile();
 }
 
 void
 NTorrentProducerApp::StopApplication()
 {
+    NTorrentMemoryTracer::ReportNode(GetNode(), "stop");
+    if (m_uploads.getDropped() > 0)
+        NS_LOG_INFO("Responses dropped by the upload scheduler: " << m_uploads.getDropped());
+    m_uploads.clear();
     App::StopApplication();
 }
 
+void
+NTorrentProducerApp::SendData(const std::shared_ptr<const Data>& data)
+{
+    m_transmittedDatas(data, this, m_face);
+    m_appLink->onReceiveData(*data);
+}
+
 void
 NTorrentProducerApp::OnInterest(shared_ptr<const Interest> interest)
 {
     ndn::App::OnInterest(interest);
     const auto& interestName = interest->getName();
 
-    ndn_ntorrent::IoUtil::NAME_TYPE interestType = ndn_ntorrent::IoUtil::findType(interestName);
+    NameId interestId = NameTable::get().find(interestName);
+    ndn_ntorrent::IoUtil::NAME_TYPE interestType = interestId != INVALID_NAME_ID ?
+            NameTable::get().getType(interestId) : classifyName(interestName);
 
-    std::shared_ptr<Data> data = nullptr;
-
-    auto cmp = [&interestName](const Data& t){return t.getFullName() == interestName;};
+    std::shared_ptr<const Data> data = m_responses.find(interestId);
 
     if(interestType != ndn_ntorrent::IoUtil::UNKNOWN)
     {
         //ndn::FibHelper::AddRoute(GetNode(), interestName, m_face, 0);
-        GlobalRoutingHelper ndnGlobalRoutingHelper;
-        ndnGlobalRoutingHelper.AddOrigin(interestName.toUri(), GetNode());
-        
-        //TODO: This can probably be optimized
-        GlobalRoutingHelper::CalculateRoutes();
-        //GlobalRoutingHelper::CalculateAllPossibleRoutes();
+        NTorrentRouting::announce(GetNode(), interestName);
     }
     
     switch(interestType)
@@ -108,12 +157,7 @@ NTorrentProducerApp::OnInterest(shared_ptr<const Interest> interest)
         case ndn_ntorrent::IoUtil::TORRENT_FILE:
         {
             NS_LOG_DEBUG("RECIEVED INTEREST (torrent-file):::" << interestName);
-            auto torrent_it =  std::find_if(m_torrentSegments.begin(), m_torrentSegments.end(), cmp);
-
-            if (m_torrentSegments.end() != torrent_it) {
-                data = std::make_shared<Data>(*torrent_it);
-            }
-            else{
+            if (nullptr == data) {
                 NS_LOG_INFO("Don't have this torrent...");
             }
             break;
@@ -121,11 +165,7 @@ NTorrentProducerApp::OnInterest(shared_ptr<const Interest> interest)
         case ndn_ntorrent::IoUtil::FILE_MANIFEST:
         {
             NS_LOG_DEBUG("RECIEVED INTEREST (file-manifest):::" << interestName);
-            auto manifest_it = std::find_if(manifests.begin(), manifests.end(), cmp);
-            if (manifests.end() != manifest_it) {
-                data = std::make_shared<Data>(*manifest_it) ;
-            }
-            else{
+            if (nullptr == data) {
                 NS_LOG_INFO("Don't have this manifest...");
             }
             break;
@@ -133,11 +173,14 @@ NTorrentProducerApp::OnInterest(shared_ptr<const Interest> interest)
         case ndn_ntorrent::IoUtil::DATA_PACKET:
         {
             NS_LOG_DEBUG("RECIEVED INTEREST (data-packet):::" << interestName);
-            auto data_it = std::find_if(dataPackets.begin(), dataPackets.end(), cmp);
-            if (dataPackets.end() != data_it) {
-                data = std::make_shared<Data>(*data_it) ;
+            //Packets that aren't resident are built on demand
+            if (nullptr == data && m_virtualTorrent != nullptr) {
+                data = m_virtualTorrent->makeDataPacket(interestName);
             }
-            else{
+            else if (nullptr == data && !m_sourceFiles.empty()) {
+                data = makeDataPacket(interestName);
+            }
+            if (nullptr == data) {
                 NS_LOG_INFO("Don't have this data...");
             }
             break;
@@ -151,50 +194,71 @@ NTorrentProducerApp::OnInterest(shared_ptr<const Interest> interest)
 
     if(nullptr != data && interestType != ndn_ntorrent::IoUtil::UNKNOWN)
     {
-        /*Signature signature;
-        SignatureInfo signatureInfo(static_cast< ::ndn::tlv::SignatureTypeValue>(255));
-
-        if (m_keyLocator.size() > 0) {
-            signatureInfo.setKeyLocator(m_keyLocator);
-        }
-
-        signature.setInfo(signatureInfo);
-        signature.setValue(::ndn::makeNonNegativeIntegerBlock(::ndn::tlv::SignatureValue, m_signature));
-
-        data->setSignature(signature);
-        NS_LOG_INFO("node(" << GetNode()->GetId() << ") responding with Data: " << data->getName());*/
-
-        data->wireEncode();
-        m_transmittedDatas(data, this, m_face);
-        m_appLink->onReceiveData(*data);
+        //Responses are signed and encoded when they are generated, see ResponseCache
+        m_uploads.enqueue(*interest, data);
     }
 }
 
 void
 NTorrentProducerApp::generateTorrentFile()
 {
-    NS_LOG_DEBUG("Creating torrent file!");
-    const auto& content = ndn_ntorrent::TorrentFile::generate(ndn_ntorrent::DUMMY_FILE_PATH,
-            m_namesPerSegment, m_namesPerManifest, m_dataPacketSize, true);
+    if (m_virtualFiles > 0) {
+        NS_LOG_DEBUG("Creating virtual torrent file!");
+        m_virtualTorrent = std::make_shared<VirtualTorrent>(m_virtualFiles, m_virtualPacketsPerFile,
+                m_virtualPayloadSize, m_namesPerSegment, m_namesPerManifest, m_virtualBundleSize,
+                m_signature, m_keyLocator);
+        m_virtualTorrent->generate(m_torrentSegments, manifests);
+    }
+    else if (!m_onDemandData && !m_imageDirectory.empty() &&
+             (m_image = TorrentImage::open(m_imageDirectory, ndn_ntorrent::DUMMY_FILE_PATH,
+                     m_namesPerSegment, m_namesPerManifest, m_dataPacketSize)) != nullptr) {
+        NS_LOG_DEBUG("Loading torrent file from " << m_image->path());
+        m_torrentSegments = m_image->torrentSegments();
+        manifests = m_image->manifests();
+        //Decoded once here, the buffers stay shared with the image
+        for (size_t i = 0; i < m_image->dataPacketCount(); i++)
+            m_responses.insert(*m_image->dataPacket(i));
+        m_residentDataPackets = m_responses.size();
+    }
+    else {
+        NS_LOG_DEBUG("Creating torrent file!");
+        const auto& content = generateTorrent(ndn_ntorrent::DUMMY_FILE_PATH,
+                m_namesPerSegment, m_namesPerManifest, m_dataPacketSize, !m_onDemandData);
+
+        m_torrentSegments = content.first;
 
-    m_torrentSegments = content.first;
+        for (const auto& ms : content.second)
+            manifests.insert(manifests.end(), ms.first.begin(), ms.first.end());
 
-    for (const auto& ms : content.second) {
-        manifests.insert(manifests.end(), ms.first.begin(), ms.first.end());
-        dataPackets.insert(dataPackets.end(), ms.second.begin(), ms.second.end());
+        if (m_onDemandData && !indexSourceFiles(content.second)) {
+            NS_LOG_ERROR("Source files don't match the torrent, keeping all data packets in memory");
+            loadDataPackets();
+        }
+        else if (!m_onDemandData) {
+            for (const auto& ms : content.second)
+                m_responses.insertAll(ms.second);
+            m_residentDataPackets = m_responses.size();
+        }
+    }
+
+    //Resident packets are encoded once here and shared by every response
+    m_responses.insertAll(m_torrentSegments);
+    m_responses.insertAll(manifests);
+    if (m_serveTorrentIndex) {
+        auto index = TorrentIndex::create(m_torrentSegments, manifests, m_namesPerManifest);
+        m_responses.insertAll(index->getSegments());
+        NS_LOG_DEBUG("Torrent index segments: " << index->getSegments().size());
     }
 
     for(const auto& t : m_torrentSegments)
         NS_LOG_DEBUG("Torrent segment name: " << t.getFullName());
     for(uint32_t i=0;i<manifests.size();i++)
         NS_LOG_DEBUG("Manifest name: " << manifests.at(i).getFullName());
-    for(uint32_t i=0;i<dataPackets.size();i++)
-        NS_LOG_DEBUG("Data: " << dataPackets.at(i).getFullName());
 
     NS_LOG_DEBUG("Producer stats: ");
     NS_LOG_DEBUG("Torrent segments: " << m_torrentSegments.size());
     NS_LOG_DEBUG("Manifests: " << manifests.size());
-    NS_LOG_DEBUG("Data Packets: " << dataPackets.size());
+    NS_LOG_DEBUG("Data Packets: " << m_residentDataPackets);
 }
 void
 NTorrentProducerApp::OnNack(shared_ptr<const lp::Nack> nack)
@@ -205,5 +269,128 @@ NTorrentProducerApp::OnNack(shared_ptr<const lp::Nack> nack)
               << ", reason: " << nack->getReason());
 }
 
+bool
+NTorrentProducerApp::indexSourceFiles(const FileManifestList& files)
+{
+    m_sourceFiles.clear();
+    m_dataIndex.clear();
+
+    //TorrentFile::generate walks DUMMY_FILE_PATH in lexicographic order, one entry of files per file
+    std::set<std::string> paths;
+    for (fs::recursive_directory_iterator it(ndn_ntorrent::DUMMY_FILE_PATH), end; it != end; ++it) {
+        if (fs::is_regular_file(it->path()))
+            paths.insert(it->path().string());
+    }
+    if (paths.size() != files.size())
+        return false;
+
+    auto path = paths.begin();
+    for (uint32_t f = 0; f < files.size(); f++, ++path) {
+        std::unique_ptr<MappedFile> source(new MappedFile);
+        if (!source->open(*path))
+            return false;
+
+        //Catalog entries follow each other in the file, dataPacketSize bytes each
+        uint64_t offset = 0;
+        for (const auto& manifest : files[f].first) {
+            for (const auto& name : manifest.catalog()) {
+                if (offset >= source->size())
+                    return false;
+                uint32_t length = std::min<uint64_t>(m_dataPacketSize, source->size() - offset);
+                m_dataIndex[NameTable::get().intern(name)] = DataLocation{f, offset, length};
+                offset += length;
+            }
+        }
+        if (offset != source->size())
+            return false;
+
+        m_sourceFiles.push_back(std::move(source));
+    }
+
+    NS_LOG_DEBUG("Serving " << m_dataIndex.size() << " data packets from " << m_sourceFiles.size() << " mapped files");
+    return true;
+}
+
+void
+NTorrentProducerApp::loadDataPackets()
+{
+    m_sourceFiles.clear();
+    m_dataIndex.clear();
+
+    const auto& content = generateTorrent(ndn_ntorrent::DUMMY_FILE_PATH,
+            m_namesPerSegment, m_namesPerManifest, m_dataPacketSize, true);
+    size_t before = m_responses.size();
+    for (const auto& ms : content.second)
+        m_responses.insertAll(ms.second);
+    m_residentDataPackets += m_responses.size() - before;
+}
+
+std::shared_ptr<const Data>
+NTorrentProducerApp::makeDataPacket(const Name& fullName)
+{
+    NameId id = NameTable::get().find(fullName);
+    auto cached = m_servedCacheIndex.find(id);
+    if (cached != m_servedCacheIndex.end()) {
+        m_servedCache.splice(m_servedCache.begin(), m_servedCache, cached->second);
+        return cached->second->second;
+    }
+
+    auto location = m_dataIndex.find(id);
+    if (location == m_dataIndex.end())
+        return nullptr;
+
+    const MappedFile& source = *m_sourceFiles[location->second.file];
+    auto data = std::make_shared<Data>(fullName.getPrefix(-1));
+    data->setContent(source.data() + location->second.offset, location->second.length);
+    StackHelper::getKeyChain().sign(*data, ::ndn::security::signingWithSha256());
+
+    //The digest in the catalog is the only thing that says these are the right bytes
+    if (data->getFullName() != fullName) {
+        NS_LOG_ERROR("Rebuilt data packet does not match its catalog entry: " << fullName
+                     << ", keeping all data packets in memory");
+        m_servedCache.clear();
+        m_servedCacheIndex.clear();
+        loadDataPackets();
+        return m_responses.find(id);
+    }
+
+    if (m_servedCacheSize > 0) {
+        m_servedCache.emplace_front(id, data);
+        m_servedCacheIndex[id] = m_servedCache.begin();
+        if (m_servedCache.size() > m_servedCacheSize) {
+            m_servedCacheIndex.erase(m_servedCache.back().first);
+            m_servedCache.pop_back();
+        }
+    }
+    return data;
+}
+
+MemoryUsageList
+NTorrentProducerApp::getMemoryUsage() const
+{
+    MemoryUsageList usage;
+    usage.push_back(dataStoreUsage("torrentSegments", m_torrentSegments));
+    usage.push_back(dataStoreUsage("manifests", manifests));
+    //Resident data packets have no store of their own, their buffers are only held by m_responses
+    MemoryUsage resident{"dataPackets", 0, 0};
+    for (const auto& response : m_responses) {
+        if (NameTable::get().getType(response.first) == ndn_ntorrent::IoUtil::DATA_PACKET) {
+            resident.objects++;
+            resident.bytes += estimateBytes(*response.second);
+        }
+    }
+    usage.push_back(resident);
+    usage.push_back(m_responses.getMemoryUsage("responses"));
+
+    usage.push_back(MemoryUsage{"dataIndex", m_dataIndex.size(),
+                                m_dataIndex.size() * (sizeof(NameId) + sizeof(DataLocation) + CONTAINER_NODE_BYTES)});
+
+    MemoryUsage served{"servedCache", m_servedCache.size(), 0};
+    for (const auto& entry : m_servedCache)
+        served.bytes += estimateBytes(*entry.second) + sizeof(NameId) + 2 * CONTAINER_NODE_BYTES;
+    usage.push_back(served);
+    return usage;
+}
+
 } // namespace ndn
 } // namespace ns3
@@ -21,8 +21,13 @@
 #include <ndn-cxx/data.hpp>
 #include <ndn-cxx/encoding/tlv.hpp>
 
+#include <list>
+#include <unordered_map>
+
 #include "ns3/ndnSIM-module.h"
+#include "ns3/boolean.h"
 #include "ns3/integer.h"
+#include "ns3/data-rate.h"
 #include "ns3/string.h"
 #include "apps/ndn-app.hpp"
 #include "NFD/rib/rib-manager.hpp"
@@ -35,6 +40,15 @@
 #include "src/util/simulation-constants.hpp"
 #include "src/util/io-util.hpp"
 
+#include "ntorrent-mapped-file.hpp"
+#include "ntorrent-memory-usage.hpp"
+#include "ntorrent-name-table.hpp"
+#include "ntorrent-response-cache.hpp"
+#include "ntorrent-torrent-image.hpp"
+#include "ntorrent-upload-scheduler.hpp"
+#include "ntorrent-torrent-index.hpp"
+#include "ntorrent-virtual-torrent.hpp"
+
 namespace ndn_ntorrent = ndn::ntorrent;
 namespace nfd_rib = nfd::rib;
 namespace nfd_fw = nfd::fw;
@@ -66,10 +80,44 @@ public:
   virtual void
   OnNack(shared_ptr<const lp::Nack> nack);
 
+  /**
+   * @brief Objects and (estimated) bytes held by each of the app's stores
+   */
+  MemoryUsageList
+  getMemoryUsage() const;
+
+private:
+  //Hand a response to the app face (called by m_uploads)
+  void
+  SendData(const std::shared_ptr<const Data>& data);
+
+private:
+  typedef std::vector<std::pair<std::vector<ndn_ntorrent::FileManifest>, std::vector<Data>>> FileManifestList;
+
+  //Map every data packet name to its bytes in the source files; false if they don't match the torrent
+  bool
+  indexSourceFiles(const FileManifestList& files);
+
+  //Generate the torrent's data packets and keep them all in m_responses
+  void
+  loadDataPackets();
+
+  //Rebuild a data packet from the mapped source file (on-demand mode); on a digest mismatch,
+  //leave on-demand mode and serve the packet from the generated ones
+  std::shared_ptr<const Data>
+  makeDataPacket(const Name& fullName);
+
 private:
   std::vector<ndn_ntorrent::TorrentFile> m_torrentSegments;
   std::vector<ndn_ntorrent::FileManifest> manifests;
-  std::vector<Data> dataPackets;
+  //Every resident response, data packets only live here
+  ResponseCache m_responses;
+  size_t m_residentDataPackets;
+
+  //Responses are shared fairly between downstream faces at UploadRate (0: unlimited)
+  DataRate m_uploadRate;
+  uint32_t m_uploadQueue;
+  UploadScheduler m_uploads;
                 
   nfd_rib::Rib m_rib;
 
@@ -84,6 +132,35 @@ private:
   uint32_t m_namesPerSegment;
   uint32_t m_namesPerManifest;
   uint32_t m_dataPacketSize;
+
+  //Virtual content mode: data packets are synthesized per Interest instead of stored
+  uint32_t m_virtualFiles;
+  uint32_t m_virtualPacketsPerFile;
+  uint32_t m_virtualBundleSize;
+  std::shared_ptr<VirtualTorrent> m_virtualTorrent;
+
+  //Directory of pre-encoded torrent images (empty: always run TorrentFile::generate)
+  std::string m_imageDirectory;
+  std::shared_ptr<const TorrentImage> m_image;
+
+  //Also serve the torrent index, so consumers can fetch all metadata at once
+  bool m_serveTorrentIndex;
+
+  //On-demand mode: only torrent segments and manifests are resident, data packets are
+  //sliced out of memory mapped source files, with the most recently served ones cached
+  struct DataLocation
+  {
+    uint32_t file;
+    uint64_t offset;
+    uint32_t length;
+  };
+
+  bool m_onDemandData;
+  uint32_t m_servedCacheSize;
+  std::vector<std::unique_ptr<MappedFile>> m_sourceFiles;
+  std::unordered_map<NameId, DataLocation> m_dataIndex;
+  std::list<std::pair<NameId, std::shared_ptr<const Data>>> m_servedCache;
+  std::unordered_map<NameId, std::list<std::pair<NameId, std::shared_ptr<const Data>>>::iterator> m_servedCacheIndex;
 };
 
 } // namespace ndn
@@ -0,0 +1,117 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_RESPONSE_CACHE_HPP
+#define NTORRENT_RESPONSE_CACHE_HPP
+
+#include "ntorrent-memory-usage.hpp"
+#include "ntorrent-name-table.hpp"
+
+#include <ndn-cxx/data.hpp>
+
+#include <memory>
+#include <unordered_map>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Responses of a seeder, encoded once and shared by every send.
+ *
+ * Packets are keyed by the interned id of their full name (the name nTorrent Interests
+ * carry), so serving an Interest is one name lookup and one refcount increment. Inserted
+ * packets are copied: the copy shares the encoded buffer and the cached full name of the
+ * original, and carries none of its link layer tags.
+ */
+class ResponseCache
+{
+public:
+  std::shared_ptr<const ::ndn::Data>
+  insert(const ::ndn::Data& data)
+  {
+    //Full names are computed (a SHA-256 of the encoding) once per Data object, by the caller's
+    auto response = std::make_shared< ::ndn::Data>(data);
+    static_cast< ::ndn::TagHost&>(*response) = ::ndn::TagHost();
+    auto inserted = m_responses.emplace(NameTable::get().intern(data.getFullName()), response);
+    return inserted.first->second;
+  }
+
+  template<typename Container>
+  void
+  insertAll(const Container& packets)
+  {
+    for (const auto& p : packets)
+      insert(p);
+  }
+
+  std::shared_ptr<const ::ndn::Data>
+  find(const ::ndn::Name& fullName) const
+  {
+    return find(NameTable::get().find(fullName));
+  }
+
+  std::shared_ptr<const ::ndn::Data>
+  find(NameId id) const
+  {
+    auto it = m_responses.find(id);
+    return it == m_responses.end() ? nullptr : it->second;
+  }
+
+  void
+  erase(NameId id)
+  {
+    m_responses.erase(id);
+  }
+
+  size_t
+  size() const
+  {
+    return m_responses.size();
+  }
+
+  //Iteration over (id, response) pairs
+  std::unordered_map<NameId, std::shared_ptr<const ::ndn::Data> >::const_iterator
+  begin() const
+  {
+    return m_responses.begin();
+  }
+
+  std::unordered_map<NameId, std::shared_ptr<const ::ndn::Data> >::const_iterator
+  end() const
+  {
+    return m_responses.end();
+  }
+
+  //Packet buffers are shared with the app stores and names with the NameTable
+  MemoryUsage
+  getMemoryUsage(const std::string& store) const
+  {
+    uint64_t entryBytes = sizeof(NameId) + sizeof(::ndn::Data) + CONTAINER_NODE_BYTES;
+    return MemoryUsage{store, m_responses.size(), m_responses.size() * entryBytes};
+  }
+
+private:
+  std::unordered_map<NameId, std::shared_ptr<const ::ndn::Data> > m_responses;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_RESPONSE_CACHE_HPP
@@ -0,0 +1,289 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-routing.hpp"
+
+#include "ns3/node-list.h"
+#include "ns3/ndnSIM/helper/boost-graph-ndn-global-routing-helper.hpp"
+
+#include <boost/graph/dijkstra_shortest_paths.hpp>
+
+#include <algorithm>
+#ifdef NTORRENT_WITH_MPI
+#include "ns3/mpi-interface.h"
+#include <mpi.h>
+#endif
+
+NS_LOG_COMPONENT_DEFINE("NTorrentRouting");
+
+namespace ns3 {
+namespace ndn {
+
+bool NTorrentRouting::s_recalculatePending = false;
+bool NTorrentRouting::s_clearScheduled = false;
+Time NTorrentRouting::s_syncInterval = Seconds(0);
+std::vector<NTorrentRouting::Update> NTorrentRouting::s_pending;
+std::map<Name, std::set<uint32_t>> NTorrentRouting::s_origins;
+std::map<Name, std::vector<std::pair<Ptr<Node>, shared_ptr<Face>>>> NTorrentRouting::s_installed;
+std::set<Name> NTorrentRouting::s_changed;
+
+static bool
+isDistributed()
+{
+#ifdef NTORRENT_WITH_MPI
+    return MpiInterface::IsEnabled() && MpiInterface::GetSize() > 1;
+#else
+    return false;
+#endif
+}
+
+//Routes only matter on the rank simulating the node
+static bool
+isLocal(Ptr<Node> node)
+{
+#ifdef NTORRENT_WITH_MPI
+    if (MpiInterface::IsEnabled())
+        return node->GetSystemId() == MpiInterface::GetSystemId();
+#endif
+    return true;
+}
+
+void
+NTorrentRouting::announce(Ptr<Node> node, const Name& prefix)
+{
+    enqueue(Update{node->GetId(), false, prefix});
+}
+
+void
+NTorrentRouting::withdraw(Ptr<Node> node, const Name& prefix)
+{
+    enqueue(Update{node->GetId(), true, prefix});
+}
+
+void
+NTorrentRouting::setSyncInterval(Time interval)
+{
+    s_syncInterval = interval;
+    if (!s_clearScheduled) {
+        Simulator::ScheduleDestroy(&NTorrentRouting::clear);
+        s_clearScheduled = true;
+    }
+}
+
+void
+NTorrentRouting::run(Time stopTime)
+{
+    if (s_syncInterval == Seconds(0)) {
+        Simulator::Stop(stopTime - Simulator::Now());
+        Simulator::Run();
+        return;
+    }
+
+    //Every rank stops at the same times, whether or not it has anything to send, and the
+    //ranks only exchange announcements while none of them is processing events
+    while (Simulator::Now() < stopTime) {
+        Simulator::Stop(std::min(s_syncInterval, stopTime - Simulator::Now()));
+        Simulator::Run();
+        synchronize();
+    }
+}
+
+void
+NTorrentRouting::enqueue(Update update)
+{
+    if (s_syncInterval == Seconds(0) && isDistributed())
+        NS_FATAL_ERROR("Distributed runs need NTorrentRouting::setSyncInterval() to share announcements between ranks");
+
+    s_pending.push_back(std::move(update));
+    if (!s_clearScheduled) {
+        Simulator::ScheduleDestroy(&NTorrentRouting::clear);
+        s_clearScheduled = true;
+    }
+    if (s_syncInterval == Seconds(0))
+        scheduleRecalculation();
+}
+
+void
+NTorrentRouting::scheduleRecalculation()
+{
+    if (!s_recalculatePending) {
+        s_recalculatePending = true;
+        Simulator::ScheduleNow(&NTorrentRouting::synchronize);
+    }
+}
+
+void
+NTorrentRouting::synchronize()
+{
+    s_recalculatePending = false;
+
+    std::vector<Update> updates = exchange(s_pending);
+    s_pending.clear();
+    if (updates.empty())
+        return;
+
+    apply(updates);
+    recalculate();
+}
+
+std::vector<NTorrentRouting::Update>
+NTorrentRouting::exchange(const std::vector<Update>& local)
+{
+    if (!isDistributed())
+        return local;
+
+#ifdef NTORRENT_WITH_MPI
+    //node id (4 bytes), withdraw flag (1 byte), then the prefix TLV
+    std::vector<uint8_t> sent;
+    for (const auto& update : local) {
+        for (int shift = 24; shift >= 0; shift -= 8)
+            sent.push_back(static_cast<uint8_t>(update.node >> shift));
+        sent.push_back(update.withdraw ? 1 : 0);
+        const Block& wire = update.prefix.wireEncode();
+        sent.insert(sent.end(), wire.wire(), wire.wire() + wire.size());
+    }
+
+    int ranks = MpiInterface::GetSize();
+    int size = static_cast<int>(sent.size());
+    std::vector<int> sizes(ranks);
+    MPI_Allgather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, MPI_COMM_WORLD);
+
+    std::vector<int> offsets(ranks, 0);
+    for (int r = 1; r < ranks; r++)
+        offsets[r] = offsets[r - 1] + sizes[r - 1];
+    std::vector<uint8_t> received(offsets[ranks - 1] + sizes[ranks - 1]);
+    if (received.empty())
+        return std::vector<Update>();
+    MPI_Allgatherv(sent.data(), size, MPI_BYTE, received.data(), sizes.data(), offsets.data(),
+                   MPI_BYTE, MPI_COMM_WORLD);
+
+    std::vector<Update> updates;
+    size_t pos = 0;
+    while (pos < received.size()) {
+        Update update;
+        update.node = 0;
+        for (int i = 0; i < 4; i++)
+            update.node = (update.node << 8) | received[pos++];
+        update.withdraw = received[pos++] != 0;
+        bool isOk = false;
+        Block wire;
+        std::tie(isOk, wire) = Block::fromBuffer(received.data() + pos, received.size() - pos);
+        if (!isOk)
+            NS_FATAL_ERROR("Malformed route announcement received from another rank");
+        update.prefix.wireDecode(wire);
+        pos += wire.size();
+        updates.push_back(std::move(update));
+    }
+    return updates;
+#else
+    return local;
+#endif
+}
+
+void
+NTorrentRouting::apply(const std::vector<Update>& updates)
+{
+    for (const auto& update : updates) {
+        if (update.withdraw) {
+            auto origins = s_origins.find(update.prefix);
+            if (origins == s_origins.end() || origins->second.erase(update.node) == 0)
+                continue;
+            if (origins->second.empty())
+                s_origins.erase(origins);
+        }
+        else if (!s_origins[update.prefix].insert(update.node).second) {
+            continue;
+        }
+        s_changed.insert(update.prefix);
+    }
+}
+
+void
+NTorrentRouting::recalculate()
+{
+    if (s_changed.empty())
+        return;
+
+    for (const auto& prefix : s_changed) {
+        auto installed = s_installed.find(prefix);
+        if (installed == s_installed.end())
+            continue;
+        for (const auto& hop : installed->second)
+            FibHelper::RemoveRoute(hop.first, prefix, hop.second);
+        s_installed.erase(installed);
+    }
+
+    NS_LOG_DEBUG("Recalculating routes to " << s_changed.size() << " prefixes");
+    boost::NdnGlobalRouterGraph graph;
+    for (auto node = NodeList::Begin(); node != NodeList::End(); ++node) {
+        Ptr<GlobalRouter> source = (*node)->GetObject<GlobalRouter>();
+        if (source == nullptr || !isLocal(*node))
+            continue;
+
+        boost::DistancesMap distances;
+        dijkstra_shortest_paths(graph, source,
+                                distance_map(boost::ref(distances))
+                                  .distance_inf(boost::WeightInf)
+                                  .distance_zero(boost::WeightZero)
+                                  .distance_compare(boost::WeightCompare())
+                                  .distance_combine(boost::WeightCombine()));
+
+        for (const auto& prefix : s_changed) {
+            auto origins = s_origins.find(prefix);
+            if (origins == s_origins.end())
+                continue;
+
+            //Cheapest origin behind each face
+            std::map<shared_ptr<Face>, uint32_t> hops;
+            for (uint32_t origin : origins->second) {
+                if (origin == (*node)->GetId())
+                    continue;
+                Ptr<GlobalRouter> router = NodeList::GetNode(origin)->GetObject<GlobalRouter>();
+                auto distance = distances.find(router);
+                if (router == nullptr || distance == distances.end() || std::get<0>(distance->second) == nullptr)
+                    continue;
+                auto hop = hops.emplace(std::get<0>(distance->second), std::get<1>(distance->second));
+                hop.first->second = std::min(hop.first->second, std::get<1>(distance->second));
+            }
+
+            auto& installed = s_installed[prefix];
+            for (const auto& hop : hops) {
+                FibHelper::AddRoute(*node, prefix, hop.first, hop.second);
+                installed.push_back(std::make_pair(*node, hop.first));
+            }
+        }
+    }
+    s_changed.clear();
+}
+
+void
+NTorrentRouting::clear()
+{
+    s_recalculatePending = false;
+    s_clearScheduled = false;
+    s_syncInterval = Seconds(0);
+    s_pending.clear();
+    s_origins.clear();
+    s_installed.clear();
+    s_changed.clear();
+}
+
+} // namespace ndn
+} // namespace ns3
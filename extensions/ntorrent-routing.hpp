@@ -0,0 +1,123 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+#ifndef NTORRENT_ROUTING_HPP
+#define NTORRENT_ROUTING_HPP
+
+#include "ns3/ndnSIM-module.h"
+#include "ns3/node.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace ns3 {
+namespace ndn {
+
+/*
+ * @brief Route announcements made by the NTorrent apps when they start seeding a name.
+ *
+ * GlobalRoutingHelper::CalculateRoutes() runs a shortest path computation from every node,
+ * so calling it once per received packet does not scale. Announcements are queued here and
+ * routes are recalculated once per simulated instant, no matter how many names were
+ * announced at that instant.
+ *
+ * With a sync interval, queued announcements are applied every interval instead, by run(),
+ * which replaces Simulator::Run. In a distributed (MPI) run every rank holds a copy of the
+ * whole topology but only runs the apps of its own nodes: run() stops the simulator on every
+ * rank at each interval, the ranks exchange what they queued and all of them apply the same
+ * updates, so a peer is reachable from every rank once the interval ends. The exchange is an
+ * MPI collective, so it never runs inside an event, where it would interleave with the
+ * distributed simulator's own window synchronization; every rank must call run().
+ * Distributed runs need an interval (no larger than the simulation time between
+ * announcements one cares about); a single process run with the same interval installs
+ * the same routes at the same times as the distributed one.
+ *
+ * The announced prefixes are kept here rather than in the nodes' GlobalRouter (which cannot
+ * forget a prefix), and routes to them are computed over the GlobalRouter graph like
+ * CalculateRoutes does, from this rank's nodes only. Only the prefixes announced or
+ * withdrawn since the last recalculation are touched: the next hops installed for them are
+ * removed (leaving e.g. the route to a holder's own app face alone) and routes to their
+ * current origins are added back.
+ */
+class NTorrentRouting
+{
+public:
+  static void
+  announce(Ptr<Node> node, const Name& prefix);
+
+  //node no longer serves prefix
+  static void
+  withdraw(Ptr<Node> node, const Name& prefix);
+
+  //Apply announcements every interval of run() (0: at the instant they are made)
+  static void
+  setSyncInterval(Time interval);
+
+  //Simulator::Run until stopTime, stopping at every sync interval to apply announcements
+  static void
+  run(Time stopTime);
+
+private:
+  struct Update
+  {
+    uint32_t node;
+    bool withdraw;
+    Name prefix;
+  };
+
+  static void
+  enqueue(Update update);
+
+  static void
+  scheduleRecalculation();
+
+  static void
+  synchronize();
+
+  //Updates queued by every rank, in rank order
+  static std::vector<Update>
+  exchange(const std::vector<Update>& local);
+
+  static void
+  apply(const std::vector<Update>& updates);
+
+  static void
+  recalculate();
+
+  static void
+  clear();
+
+private:
+  static bool s_recalculatePending;
+  static bool s_clearScheduled;
+  static Time s_syncInterval;
+  static std::vector<Update> s_pending;
+  //Ids of the nodes announcing each prefix
+  static std::map<Name, std::set<uint32_t>> s_origins;
+  //Next hops installed for each prefix
+  static std::map<Name, std::vector<std::pair<Ptr<Node>, shared_ptr<Face>>>> s_installed;
+  //Prefixes whose origins changed since the last recalculation
+  static std::set<Name> s_changed;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_ROUTING_HPP
@@ -0,0 +1,103 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-torrent-generator.hpp"
+#include "ntorrent-parallel.hpp"
+
+#include "src/util/shared-constants.hpp"
+
+#include "ns3/abort.h"
+#include "ns3/ndnSIM/helper/ndn-stack-helper.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <set>
+
+namespace fs = boost::filesystem;
+
+namespace ns3 {
+namespace ndn {
+
+TorrentContent
+generateTorrent(const std::string& directoryPath, size_t namesPerSegment, size_t namesPerManifest,
+                size_t dataPacketSize, bool returnData, size_t threads)
+{
+  NS_ABORT_MSG_IF(namesPerSegment == 0 || namesPerManifest == 0, "Names per segment/manifest must be > 0");
+  NS_ABORT_MSG_IF(!fs::is_directory(directoryPath), directoryPath << ": no such directory");
+
+  //Names are the same TorrentFile::generate gives: /NTORRENT/<directory>/<file relative path>
+  Name directoryName(directoryPath);
+  Name commonPrefix(std::string(ndn_ntorrent::SharedConstants::commonPrefix) + "/NTORRENT" +
+                    directoryName.getSubName(directoryName.size() - 1).toUri());
+
+  //Lexicographic order, like TorrentFile::generate
+  std::set<std::string> paths;
+  for (fs::recursive_directory_iterator it(directoryPath), end; it != end; ++it) {
+    if (fs::is_regular_file(it->path()))
+      paths.insert(it->path().string());
+  }
+  std::vector<std::string> files(paths.begin(), paths.end());
+
+  //Names encode themselves lazily; do it for the shared prefix before threads start copying it
+  commonPrefix.wireEncode();
+
+  TorrentContent content;
+  content.second.resize(files.size());
+  parallelFor(files.size(), [&] (size_t f) {
+    Name manifestPrefix(commonPrefix.toUri() + files[f].substr(directoryPath.size()));
+    content.second[f] = ndn_ntorrent::FileManifest::generate(files[f], manifestPrefix,
+            namesPerManifest, dataPacketSize, returnData);
+  }, threads);
+
+  //The torrent file only lists the initial manifest of every file; each segment points at
+  //the full name (including digest) of the one after it, so build them back to front
+  std::vector<Name> initialManifests;
+  for (const auto& ms : content.second)
+    initialManifests.push_back(ms.first.at(0).getFullName());
+
+  size_t segmentCount = std::max<size_t>(1, (initialManifests.size() + namesPerSegment - 1) / namesPerSegment);
+  std::vector<ndn_ntorrent::TorrentFile> segments;
+  Name next;
+
+  for (size_t s = segmentCount; s-- > 0;) {
+    auto begin = initialManifests.begin() + std::min(initialManifests.size(), s * namesPerSegment);
+    auto end = initialManifests.begin() + std::min(initialManifests.size(), (s + 1) * namesPerSegment);
+    std::vector<Name> catalog(begin, end);
+    Name segmentName = Name(commonPrefix).append("torrent-file").appendSequenceNumber(s);
+
+    if (next.empty())
+      segments.push_back(ndn_ntorrent::TorrentFile(segmentName, commonPrefix, catalog));
+    else
+      segments.push_back(ndn_ntorrent::TorrentFile(segmentName, next, commonPrefix, catalog));
+
+    segments.back().finalize();
+    StackHelper::getKeyChain().sign(segments.back(), ::ndn::security::signingWithSha256());
+    next = segments.back().getFullName();
+  }
+
+  content.first.assign(segments.rbegin(), segments.rend());
+  return content;
+}
+
+} // namespace ndn
+} // namespace ns3
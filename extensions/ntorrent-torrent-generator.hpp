@@ -0,0 +1,59 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_TORRENT_GENERATOR_HPP
+#define NTORRENT_TORRENT_GENERATOR_HPP
+
+#include <ndn-cxx/data.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "src/torrent-file.hpp"
+#include "src/file-manifest.hpp"
+
+namespace ndn_ntorrent = ndn::ntorrent;
+
+namespace ns3 {
+namespace ndn {
+
+//Torrent file segments, then (manifests, data packets) of every file, as TorrentFile::generate returns them
+typedef std::pair<std::vector<ndn_ntorrent::TorrentFile>,
+                  std::vector<std::pair<std::vector<ndn_ntorrent::FileManifest>,
+                                        std::vector< ::ndn::Data>>>> TorrentContent;
+
+/*
+ * @brief Parallel TorrentFile::generate for the files in directoryPath.
+ *
+ * Files are independent: each one is packetized and its manifest chain built (by
+ * FileManifest::generate) on its own thread, out of `threads` (0: every core). Only the torrent
+ * file segments, which list the initial manifest of every file, are built afterwards, back to
+ * front like TorrentFile::generate does. The output is meant to be byte-identical to
+ * TorrentFile::generate; ntorrent-microbench checks it.
+ */
+TorrentContent
+generateTorrent(const std::string& directoryPath, size_t namesPerSegment, size_t namesPerManifest,
+                size_t dataPacketSize, bool returnData, size_t threads = 0);
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_TORRENT_GENERATOR_HPP
@@ -0,0 +1,298 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-torrent-image.hpp"
+#include "ntorrent-parallel.hpp"
+#include "ntorrent-torrent-generator.hpp"
+
+#include "ns3/log.h"
+
+#include <boost/filesystem.hpp>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+NS_LOG_COMPONENT_DEFINE("NTorrentTorrentImage");
+
+namespace fs = boost::filesystem;
+
+namespace ns3 {
+namespace ndn {
+
+static const char IMAGE_MAGIC[8] = {'N', 'T', 'I', 'M', 'G', 0, 0, 0};
+static const uint32_t IMAGE_VERSION = 1;
+
+struct ImageHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t key;
+  uint64_t count[3];
+};
+
+//FNV-1a, so keys (and image names) are the same for every build of the simulator
+static uint64_t
+hashBytes(uint64_t hash, const std::string& bytes)
+{
+  for (unsigned char c : bytes) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static uint64_t
+imageKey(const std::string& sourcePath, size_t namesPerSegment, size_t namesPerManifest,
+         size_t dataPacketSize)
+{
+  std::ostringstream inputs;
+  inputs << IMAGE_VERSION << ' ' << fs::absolute(sourcePath).string() << ' '
+         << namesPerSegment << ' ' << namesPerManifest << ' ' << dataPacketSize << '\n';
+
+  std::set<fs::path> files;
+  for (fs::recursive_directory_iterator it(sourcePath), end; it != end; ++it) {
+    if (fs::is_regular_file(it->path()))
+      files.insert(it->path());
+  }
+  for (const auto& file : files)
+    inputs << file.string() << ' ' << fs::file_size(file) << ' ' << fs::last_write_time(file) << '\n';
+
+  return hashBytes(14695981039346656037ULL, inputs.str());
+}
+
+std::shared_ptr<const TorrentImage>
+TorrentImage::open(const std::string& directory, const std::string& sourcePath,
+                   size_t namesPerSegment, size_t namesPerManifest, size_t dataPacketSize)
+{
+  static std::map<std::string, std::shared_ptr<const TorrentImage>> images;
+
+  try {
+    uint64_t key = imageKey(sourcePath, namesPerSegment, namesPerManifest, dataPacketSize);
+    std::ostringstream name;
+    name << "ntorrent-" << std::hex << std::setw(16) << std::setfill('0') << key << ".img";
+    std::string path = (fs::path(directory) / name.str()).string();
+
+    auto it = images.find(path);
+    if (it != images.end())
+      return it->second;
+
+    auto image = std::shared_ptr<TorrentImage>(new TorrentImage);
+    if (!image->load(path, key)) {
+      NS_LOG_INFO("Building torrent image " << path);
+      fs::create_directories(directory);
+      if (!build(path, key, sourcePath, namesPerSegment, namesPerManifest, dataPacketSize) ||
+          !image->load(path, key)) {
+        NS_LOG_WARN("Cannot build torrent image " << path);
+        return nullptr;
+      }
+    }
+
+    images[path] = image;
+    return image;
+  }
+  catch (const fs::filesystem_error& e) {
+    NS_LOG_WARN("Cannot use torrent image: " << e.what());
+    return nullptr;
+  }
+}
+
+bool
+TorrentImage::build(const std::string& path, uint64_t key, const std::string& sourcePath,
+                    size_t namesPerSegment, size_t namesPerManifest, size_t dataPacketSize)
+{
+  const auto& content = generateTorrent(sourcePath, namesPerSegment, namesPerManifest, dataPacketSize, true);
+
+  std::vector<Block> blocks[SECTION_COUNT];
+  for (const auto& segment : content.first)
+    blocks[TORRENT_SEGMENTS].push_back(segment.wireEncode());
+
+  //Data packets are looked up by walking the manifest catalogs, so they must follow them
+  std::vector<Name> catalog;
+  for (const auto& ms : content.second) {
+    for (const auto& manifest : ms.first) {
+      blocks[MANIFESTS].push_back(manifest.wireEncode());
+      catalog.insert(catalog.end(), manifest.catalog().begin(), manifest.catalog().end());
+    }
+    for (const auto& data : ms.second)
+      blocks[DATA_PACKETS].push_back(data.wireEncode());
+  }
+  if (catalog.size() != blocks[DATA_PACKETS].size())
+    return false;
+  std::atomic<bool> matches(true);
+  parallelFor(catalog.size(), [&] (size_t i) {
+    if (Data(blocks[DATA_PACKETS][i]).getFullName() != catalog[i])
+      matches = false;
+  });
+  if (!matches)
+    return false;
+
+  ImageHeader header;
+  std::memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+  header.version = IMAGE_VERSION;
+  header.reserved = 0;
+  header.key = key;
+
+  size_t entries = 0;
+  for (int s = 0; s < SECTION_COUNT; s++) {
+    header.count[s] = blocks[s].size();
+    entries += blocks[s].size();
+  }
+
+  //Write next to the final name and rename, so concurrent runs never map a partial image
+  std::string tmpPath = path + ".tmp." + std::to_string(::getpid());
+  {
+    std::ofstream os(tmpPath, std::ios::binary | std::ios::trunc);
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    IndexEntry entry{sizeof(header) + entries * sizeof(IndexEntry), 0};
+    for (int s = 0; s < SECTION_COUNT; s++) {
+      for (const auto& block : blocks[s]) {
+        entry.length = block.size();
+        os.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        entry.offset += entry.length;
+      }
+    }
+    for (int s = 0; s < SECTION_COUNT; s++) {
+      for (const auto& block : blocks[s])
+        os.write(reinterpret_cast<const char*>(block.wire()), block.size());
+    }
+
+    if (!os) {
+      fs::remove(tmpPath);
+      return false;
+    }
+  }
+  fs::rename(tmpPath, path);
+  return true;
+}
+
+bool
+TorrentImage::load(const std::string& path, uint64_t key)
+{
+  if (!m_file.open(path) || m_file.size() < sizeof(ImageHeader))
+    return false;
+
+  ImageHeader header;
+  std::memcpy(&header, m_file.data(), sizeof(header));
+  if (std::memcmp(header.magic, IMAGE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != IMAGE_VERSION || header.key != key) {
+    m_file.close();
+    return false;
+  }
+
+  uint64_t entries = 0;
+  for (int s = 0; s < SECTION_COUNT; s++) {
+    m_count[s] = header.count[s];
+    m_index[s] = reinterpret_cast<const IndexEntry*>(m_file.data() + sizeof(header)) + entries;
+    entries += m_count[s];
+  }
+
+  //A truncated or corrupted image is rebuilt rather than trusted
+  if ((m_file.size() - sizeof(header)) / sizeof(IndexEntry) < entries) {
+    m_file.close();
+    return false;
+  }
+  for (int s = 0; s < SECTION_COUNT; s++) {
+    for (uint64_t i = 0; i < m_count[s]; i++) {
+      const IndexEntry& entry = m_index[s][i];
+      if (entry.offset > m_file.size() || entry.length > m_file.size() - entry.offset) {
+        m_file.close();
+        return false;
+      }
+    }
+  }
+  for (int s = 0; s < SECTION_COUNT; s++)
+    m_blocks[s].assign(m_count[s], Block());
+
+  //Data packets follow the manifest catalogs (see build)
+  m_dataIndex.clear();
+  try {
+    for (size_t i = 0; i < m_count[MANIFESTS]; i++) {
+      for (const auto& name : ndn_ntorrent::FileManifest(block(MANIFESTS, i)).catalog())
+        m_dataIndex.emplace(name, m_dataIndex.size());
+    }
+  }
+  catch (const ::ndn::tlv::Error& e) {
+    NS_LOG_WARN("Corrupted manifest in torrent image " << path << ": " << e.what());
+    m_dataIndex.clear();
+  }
+  if (m_dataIndex.size() != m_count[DATA_PACKETS]) {
+    m_file.close();
+    return false;
+  }
+  return true;
+}
+
+const Block&
+TorrentImage::block(Section section, size_t i) const
+{
+  Block& cached = m_blocks[section][i];
+  if (!cached.hasWire()) {
+    const IndexEntry& entry = m_index[section][i];
+    cached = Block(m_file.data() + entry.offset, entry.length);
+  }
+  return cached;
+}
+
+std::vector<ndn_ntorrent::TorrentFile>
+TorrentImage::torrentSegments() const
+{
+  std::vector<ndn_ntorrent::TorrentFile> segments;
+  segments.reserve(m_count[TORRENT_SEGMENTS]);
+  for (size_t i = 0; i < m_count[TORRENT_SEGMENTS]; i++)
+    segments.emplace_back(block(TORRENT_SEGMENTS, i));
+  return segments;
+}
+
+std::vector<ndn_ntorrent::FileManifest>
+TorrentImage::manifests() const
+{
+  std::vector<ndn_ntorrent::FileManifest> manifests;
+  manifests.reserve(m_count[MANIFESTS]);
+  for (size_t i = 0; i < m_count[MANIFESTS]; i++)
+    manifests.emplace_back(block(MANIFESTS, i));
+  return manifests;
+}
+
+std::shared_ptr<Data>
+TorrentImage::dataPacket(size_t i) const
+{
+  return std::make_shared<Data>(block(DATA_PACKETS, i));
+}
+
+std::shared_ptr<Data>
+TorrentImage::findDataPacket(const Name& fullName) const
+{
+  auto it = m_dataIndex.find(fullName);
+  if (it == m_dataIndex.end())
+    return nullptr;
+  return dataPacket(it->second);
+}
+
+} // namespace ndn
+} // namespace ns3
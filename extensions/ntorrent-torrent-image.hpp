@@ -0,0 +1,142 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_TORRENT_IMAGE_HPP
+#define NTORRENT_TORRENT_IMAGE_HPP
+
+#include "ntorrent-mapped-file.hpp"
+
+#include <ndn-cxx/data.hpp>
+
+#include "src/torrent-file.hpp"
+#include "src/file-manifest.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ndn_ntorrent = ndn::ntorrent;
+
+namespace ns3 {
+namespace ndn {
+
+using ::ndn::Block;
+using ::ndn::Data;
+using ::ndn::Name;
+
+/*
+ * @brief Pre-encoded torrent kept on disk, so TorrentFile::generate (and its SHA-256 work)
+ * runs once per set of inputs instead of once per node per run.
+ *
+ * The image holds the wire encoding of every torrent file segment, file manifest and data
+ * packet in the order TorrentFile::generate returns them, behind an offset index:
+ *
+ *   header   magic "NTIMG", version, key, number of entries of each section
+ *   index    (offset, length) of every entry, all sections back to back
+ *   blocks   wire encodings
+ *
+ * The key hashes the generation parameters and the path, size and mtime of every input file.
+ * It is part of the image file name, so changing any input selects (and builds) another image.
+ * Integers are stored in host byte order: an image is a local cache, not an exchange format.
+ *
+ * Images are memory mapped and shared by all apps of the process that use the same inputs.
+ * ndn-cxx buffers own their bytes, so an entry is copied out of the mapping the first time it
+ * is used; that copy is kept and shared by every packet made from the entry afterwards.
+ */
+class TorrentImage
+{
+public:
+  /*
+   * @brief Open the image of sourcePath for these parameters in directory, building it first
+   * if it is missing or stale
+   * @return nullptr if the image can neither be loaded nor written
+   */
+  static std::shared_ptr<const TorrentImage>
+  open(const std::string& directory, const std::string& sourcePath,
+       size_t namesPerSegment, size_t namesPerManifest, size_t dataPacketSize);
+
+  std::vector<ndn_ntorrent::TorrentFile>
+  torrentSegments() const;
+
+  std::vector<ndn_ntorrent::FileManifest>
+  manifests() const;
+
+  size_t
+  dataPacketCount() const
+  {
+    return m_count[DATA_PACKETS];
+  }
+
+  std::shared_ptr<Data>
+  dataPacket(size_t i) const;
+
+  /*
+   * @brief Data packet whose full name (as listed in the manifest catalogs) is fullName
+   * @return nullptr if the image has no such packet
+   */
+  std::shared_ptr<Data>
+  findDataPacket(const Name& fullName) const;
+
+  const std::string&
+  path() const
+  {
+    return m_file.path();
+  }
+
+private:
+  enum Section {
+    TORRENT_SEGMENTS,
+    MANIFESTS,
+    DATA_PACKETS,
+    SECTION_COUNT
+  };
+
+  struct IndexEntry
+  {
+    uint64_t offset;
+    uint64_t length;
+  };
+
+  bool
+  load(const std::string& path, uint64_t key);
+
+  static bool
+  build(const std::string& path, uint64_t key, const std::string& sourcePath,
+        size_t namesPerSegment, size_t namesPerManifest, size_t dataPacketSize);
+
+  //Encoding of entry i of section, copied out of the mapping on first use
+  const Block&
+  block(Section section, size_t i) const;
+
+private:
+  MappedFile m_file;
+  const IndexEntry* m_index[SECTION_COUNT];
+  uint64_t m_count[SECTION_COUNT];
+  mutable std::vector<Block> m_blocks[SECTION_COUNT];
+
+  //Catalog name -> data packet, built by load()
+  std::unordered_map<Name, size_t> m_dataIndex;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_TORRENT_IMAGE_HPP
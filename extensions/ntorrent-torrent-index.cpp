@@ -0,0 +1,136 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-torrent-index.hpp"
+#include "ntorrent-name-classifier.hpp"
+
+#include "ns3/abort.h"
+#include "ns3/ndnSIM/helper/ndn-stack-helper.hpp"
+
+#include <ndn-cxx/security/signing-helpers.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace ns3 {
+namespace ndn {
+
+static const char INDEX_COMPONENT[] = "index";
+
+typedef std::pair<Name, size_t> IndexKey;
+
+static std::map<IndexKey, std::shared_ptr<const TorrentIndex>>&
+getIndexes()
+{
+  static std::map<IndexKey, std::shared_ptr<const TorrentIndex>> indexes;
+  return indexes;
+}
+
+static Data
+makeIndexSegment(const Name& prefix, size_t k, const std::vector<Name>& names)
+{
+  Data segment(Name(prefix).appendSequenceNumber(k));
+  ::ndn::Block content(::ndn::tlv::Content);
+  for (const auto& name : names)
+    content.push_back(name.wireEncode());
+  content.encode();
+  segment.setContent(content);
+  StackHelper::getKeyChain().sign(segment, ::ndn::security::signingWithSha256());
+  return segment;
+}
+
+std::shared_ptr<const TorrentIndex>
+TorrentIndex::create(const std::vector<ndn_ntorrent::TorrentFile>& segments,
+                     const std::vector<ndn_ntorrent::FileManifest>& manifests, size_t namesPerSegment)
+{
+  NS_ABORT_MSG_IF(segments.empty() || namesPerSegment == 0, "Cannot index an empty torrent");
+
+  const Name& initialName = segments.front().getFullName();
+  auto& index = getIndexes()[IndexKey(initialName, namesPerSegment)];
+  if (index != nullptr)
+    return index;
+
+  //<torrent prefix>/index/torrent-file
+  size_t torrentFile = 0;
+  while (torrentFile < initialName.size() && !isTorrentFileComponent(initialName.get(torrentFile)))
+    torrentFile++;
+  NS_ABORT_MSG_IF(torrentFile == initialName.size(), "Not a torrent file segment: " << initialName);
+  Name prefix = initialName.getPrefix(torrentFile).append(INDEX_COMPONENT).append(TORRENT_FILE_COMPONENT);
+
+  std::vector<Name> names;
+  for (const auto& segment : segments)
+    names.push_back(segment.getFullName());
+  for (const auto& manifest : manifests)
+    names.push_back(manifest.getFullName());
+
+  //The root lists the other index segments, so they are built first
+  auto result = std::make_shared<TorrentIndex>();
+  size_t count = (names.size() + namesPerSegment - 1) / namesPerSegment;
+  std::vector<Data> others;
+  std::vector<Name> rootNames;
+  for (size_t k = 1; k < count; k++) {
+    auto begin = names.begin() + k * namesPerSegment;
+    auto end = names.begin() + std::min(names.size(), (k + 1) * namesPerSegment);
+    others.push_back(makeIndexSegment(prefix, k, std::vector<Name>(begin, end)));
+    rootNames.push_back(others.back().getFullName());
+  }
+  rootNames.insert(rootNames.end(), names.begin(), names.begin() + std::min(names.size(), namesPerSegment));
+
+  result->m_segments.push_back(makeIndexSegment(prefix, 0, rootNames));
+  result->m_segments.insert(result->m_segments.end(), others.begin(), others.end());
+  index = result;
+  return index;
+}
+
+std::shared_ptr<const TorrentIndex>
+TorrentIndex::find(const Name& initialSegmentFullName, size_t namesPerSegment)
+{
+  auto it = getIndexes().find(IndexKey(initialSegmentFullName, namesPerSegment));
+  return it == getIndexes().end() ? nullptr : it->second;
+}
+
+bool
+TorrentIndex::isIndexName(const Name& fullName)
+{
+  if (fullName.size() < 4 || !isTorrentFileComponent(fullName.get(-3)))
+    return false;
+
+  const auto& component = fullName.get(-4);
+  return component.type() == ::ndn::tlv::GenericNameComponent &&
+         component.value_size() == sizeof(INDEX_COMPONENT) - 1 &&
+         std::memcmp(component.value(), INDEX_COMPONENT, sizeof(INDEX_COMPONENT) - 1) == 0;
+}
+
+std::vector<Name>
+TorrentIndex::decode(const Data& segment)
+{
+  std::vector<Name> names;
+  ::ndn::Block content = segment.getContent();
+  content.parse();
+  for (const auto& element : content.elements()) {
+    if (element.type() == ::ndn::tlv::Name)
+      names.emplace_back(element);
+  }
+  return names;
+}
+
+} // namespace ndn
+} // namespace ns3
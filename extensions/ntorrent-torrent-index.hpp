@@ -0,0 +1,99 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_TORRENT_INDEX_HPP
+#define NTORRENT_TORRENT_INDEX_HPP
+
+#include <ndn-cxx/data.hpp>
+
+#include "src/torrent-file.hpp"
+#include "src/file-manifest.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace ndn_ntorrent = ndn::ntorrent;
+
+namespace ns3 {
+namespace ndn {
+
+using ::ndn::Data;
+using ::ndn::Name;
+
+/*
+ * @brief Skip index of a torrent's metadata, so it can be fetched in about one round trip.
+ *
+ * Torrent file segments and file manifests are linked lists: each one names the next, so
+ * walking them costs one RTT per segment. The index lists the full names of all of them.
+ * It is split in segments of namesPerSegment names; the root segment additionally lists the
+ * full names of the other index segments, so every index segment can be requested as soon
+ * as the root arrives, and everything else right after.
+ *
+ * Index segments are named <torrent prefix>/index/torrent-file/<k>, <torrent prefix> being the
+ * name of the initial torrent file segment up to (excluding) its "torrent-file" component,
+ * so they classify as torrent file segments. Their content is the list of Name TLVs. They
+ * carry a DigestSha256 signature (deterministic, and checked by consumers like any other):
+ * any node building the index of the same torrent gets the same digests, and the root's
+ * digest is the consumer's trust anchor.
+ */
+class TorrentIndex
+{
+public:
+  /*
+   * @brief Index of the torrent made of segments and manifests (built once per process,
+   *        keyed by the full name of the initial segment and namesPerSegment)
+   */
+  static std::shared_ptr<const TorrentIndex>
+  create(const std::vector<ndn_ntorrent::TorrentFile>& segments,
+         const std::vector<ndn_ntorrent::FileManifest>& manifests, size_t namesPerSegment);
+
+  //The index already built for this initial segment, nullptr if none
+  static std::shared_ptr<const TorrentIndex>
+  find(const Name& initialSegmentFullName, size_t namesPerSegment);
+
+  //True if fullName is the full name of an index segment
+  static bool
+  isIndexName(const Name& fullName);
+
+  //Names listed by an index segment
+  static std::vector<Name>
+  decode(const Data& segment);
+
+  //Root first
+  const std::vector<Data>&
+  getSegments() const
+  {
+    return m_segments;
+  }
+
+  const Data&
+  getRoot() const
+  {
+    return m_segments.front();
+  }
+
+private:
+  std::vector<Data> m_segments;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_TORRENT_INDEX_HPP
@@ -0,0 +1,115 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-upload-scheduler.hpp"
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+NS_LOG_COMPONENT_DEFINE("NTorrentUploadScheduler");
+
+namespace ns3 {
+namespace ndn {
+
+UploadScheduler::UploadScheduler(const SendCallback& send)
+  : m_send(send)
+  , m_rate(0)
+  , m_quantum(1500)
+  , m_queueLimit(64)
+  , m_dropped(0)
+{
+}
+
+bool
+UploadScheduler::enqueue(const ::ndn::Interest& interest, const std::shared_ptr<const ::ndn::Data>& data)
+{
+  uint64_t face = getIncomingFaceId(interest);
+
+  if (m_rate.GetBitRate() == 0) {
+    m_send(face, data);
+    return true;
+  }
+
+  FaceQueue& queue = m_queues[face];
+  if (queue.responses.size() >= m_queueLimit) {
+    NS_LOG_DEBUG("Upload queue of face " << face << " is full, dropping " << data->getName());
+    m_dropped++;
+    return false;
+  }
+
+  if (queue.responses.empty())
+    m_round.push_back(face);
+  queue.responses.push_back(data);
+
+  if (!m_sendEvent.IsRunning())
+    sendNext();
+  return true;
+}
+
+void
+UploadScheduler::sendNext()
+{
+  while (!m_round.empty()) {
+    uint64_t face = m_round.front();
+    FaceQueue& queue = m_queues[face];
+    const auto& data = queue.responses.front();
+    uint32_t size = data->wireEncode().size();
+
+    //Not enough credit: top it up and let the next face take its turn
+    if (queue.deficit < size) {
+      queue.deficit += m_quantum;
+      m_round.pop_front();
+      m_round.push_back(face);
+      continue;
+    }
+
+    queue.deficit -= size;
+    m_send(face, data);
+    queue.responses.pop_front();
+    //An idle face doesn't keep credit for later
+    if (queue.responses.empty()) {
+      queue.deficit = 0;
+      m_round.pop_front();
+    }
+
+    m_sendEvent = Simulator::Schedule(m_rate.CalculateBytesTxTime(size), &UploadScheduler::sendNext, this);
+    return;
+  }
+}
+
+void
+UploadScheduler::clear()
+{
+  Simulator::Cancel(m_sendEvent);
+  m_queues.clear();
+  m_round.clear();
+}
+
+size_t
+UploadScheduler::size() const
+{
+  size_t responses = 0;
+  for (const auto& queue : m_queues)
+    responses += queue.second.responses.size();
+  return responses;
+}
+
+} // namespace ndn
+} // namespace ns3
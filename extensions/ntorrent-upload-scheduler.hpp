@@ -0,0 +1,133 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_UPLOAD_SCHEDULER_HPP
+#define NTORRENT_UPLOAD_SCHEDULER_HPP
+
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/interest.hpp>
+#include <ndn-cxx/lp/tags.hpp>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace ns3 {
+namespace ndn {
+
+//Face of the node a packet delivered to an app came in on (0 if it carries no IncomingFaceIdTag)
+inline uint64_t
+getIncomingFaceId(const ::ndn::TagHost& packet)
+{
+  auto tag = packet.getTag< ::ndn::lp::IncomingFaceIdTag>();
+  return tag != nullptr ? tag->get() : 0;
+}
+
+/*
+ * @brief Deficit round robin over the downstream faces of a seeder, paced at an upload rate.
+ *
+ * Apps only see their own app face; the downstream face an Interest came in on is read from
+ * its IncomingFaceIdTag. Every face gets a queue of responses and a deficit: each round adds
+ * the quantum to the deficit of the face at the head of the round, which sends responses
+ * while the deficit covers them. One response is on the "wire" at a time, for its size at
+ * the upload rate, so a face asking for everything gets the same share of the rate as one
+ * asking for a single piece. Responses beyond the per-face queue limit are dropped; the
+ * downstream retransmits.
+ *
+ * With a zero rate the scheduler is a pass-through and sends every response right away.
+ */
+class UploadScheduler
+{
+public:
+  //Called with the downstream face when a response actually leaves the scheduler
+  typedef std::function<void(uint64_t face, const std::shared_ptr<const ::ndn::Data>&)> SendCallback;
+
+  explicit
+  UploadScheduler(const SendCallback& send);
+
+  void
+  setRate(DataRate rate)
+  {
+    m_rate = rate;
+  }
+
+  //Bytes a face may send per round
+  void
+  setQuantum(uint32_t quantum)
+  {
+    m_quantum = quantum;
+  }
+
+  //Responses queued per face before new ones are dropped
+  void
+  setQueueLimit(uint32_t limit)
+  {
+    m_queueLimit = limit;
+  }
+
+  //Queue the response to interest (sent at once with a zero rate); false if it was dropped
+  bool
+  enqueue(const ::ndn::Interest& interest, const std::shared_ptr<const ::ndn::Data>& data);
+
+  //Drop every queued response
+  void
+  clear();
+
+  size_t
+  size() const;
+
+  uint64_t
+  getDropped() const
+  {
+    return m_dropped;
+  }
+
+private:
+  void
+  sendNext();
+
+private:
+  struct FaceQueue
+  {
+    std::deque<std::shared_ptr<const ::ndn::Data> > responses;
+    uint32_t deficit = 0;
+  };
+
+  SendCallback m_send;
+  DataRate m_rate;
+  uint32_t m_quantum;
+  uint32_t m_queueLimit;
+
+  std::map<uint64_t, FaceQueue> m_queues;
+  //Faces with queued responses, in round order
+  std::deque<uint64_t> m_round;
+  EventId m_sendEvent;
+  uint64_t m_dropped;
+};
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_UPLOAD_SCHEDULER_HPP
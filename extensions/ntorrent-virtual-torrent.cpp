@@ -0,0 +1,298 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "ntorrent-virtual-torrent.hpp"
+#include "ntorrent-parallel.hpp"
+
+#include "src/util/shared-constants.hpp"
+
+#include <ndn-cxx/encoding/block-helpers.hpp>
+#include <ndn-cxx/signature.hpp>
+
+#include "ns3/abort.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+
+namespace ns3 {
+namespace ndn {
+
+static const std::string FILE_COMPONENT_PREFIX = "file-";
+
+VirtualTorrent::VirtualTorrent(uint32_t files, uint32_t packetsPerFile, uint32_t payloadSize,
+                               uint32_t namesPerSegment, uint32_t namesPerManifest, uint32_t bundleSize,
+                               uint32_t signatureValue, const Name& keyLocator, uint32_t threads)
+  : m_prefix(Name(ndn_ntorrent::SharedConstants::commonPrefix).append("NTORRENT").append("virtual"))
+  , m_files(files)
+  , m_packetsPerFile(packetsPerFile)
+  , m_payloadSize(payloadSize)
+  , m_namesPerSegment(namesPerSegment)
+  , m_namesPerManifest(namesPerManifest)
+  , m_bundleSize(bundleSize)
+  , m_unitsPerFile(bundleSize == 0 ? 0 : (packetsPerFile + bundleSize - 1) / bundleSize)
+  , m_signatureValue(signatureValue)
+  , m_keyLocator(keyLocator)
+  , m_threads(threads)
+{
+  NS_ABORT_MSG_IF(m_files == 0 || m_packetsPerFile == 0, "Virtual torrent needs at least one packet");
+  NS_ABORT_MSG_IF(m_namesPerSegment == 0 || m_namesPerManifest == 0, "Names per segment/manifest must be > 0");
+  NS_ABORT_MSG_IF(m_bundleSize == 0, "Bundle size must be > 0");
+}
+
+Name
+VirtualTorrent::getFileName(uint32_t file) const
+{
+  return Name(m_prefix).append(FILE_COMPONENT_PREFIX + std::to_string(file));
+}
+
+void
+VirtualTorrent::generate(std::vector<ndn_ntorrent::TorrentFile>& torrentSegments,
+                         std::vector<ndn_ntorrent::FileManifest>& manifests) const
+{
+  const auto& content = getContent();
+  torrentSegments.insert(torrentSegments.end(), content.torrentSegments.begin(), content.torrentSegments.end());
+  manifests.insert(manifests.end(), content.manifests.begin(), content.manifests.end());
+}
+
+ndn_ntorrent::TorrentFile
+VirtualTorrent::getInitialSegment() const
+{
+  return getContent().torrentSegments.at(0);
+}
+
+const VirtualTorrent::Content&
+VirtualTorrent::getContent() const
+{
+  //Every app of a run asks for the same torrent; hash it once per process
+  typedef std::tuple<uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, Name> Key;
+  static std::map<Key, std::unique_ptr<Content>> contents;
+
+  auto& content = contents[Key(m_files, m_packetsPerFile, m_payloadSize, m_namesPerSegment, m_namesPerManifest,
+                               m_bundleSize, m_signatureValue, m_keyLocator)];
+  if (content == nullptr) {
+    content.reset(new Content);
+    build(*content);
+  }
+  return *content;
+}
+
+void
+VirtualTorrent::build(Content& content) const
+{
+  //Names encode themselves lazily; do it for the shared prefix before threads start copying it
+  m_prefix.wireEncode();
+  m_keyLocator.wireEncode();
+
+  //Packet (or bundle) digests don't depend on each other: compute all of them on every core
+  std::vector<Name> packetNames(size_t(m_files) * m_unitsPerFile);
+  parallelFor(packetNames.size(), [this, &packetNames] (size_t i) {
+    uint32_t f = i / m_unitsPerFile;
+    uint32_t u = i % m_unitsPerFile;
+    packetNames[i] = makeDataPacket(f, u / m_namesPerManifest, u)->getFullName();
+  }, m_threads);
+
+  //Manifests and segments are built back to front, so each one can point at the full name
+  //(including digest) of the one after it. Manifest chains of different files are independent.
+  uint32_t manifestCount = (m_unitsPerFile + m_namesPerManifest - 1) / m_namesPerManifest;
+  std::vector<std::vector<ndn_ntorrent::FileManifest>> fileManifests(m_files);
+  std::vector<Name> initialManifests(m_files);
+
+  parallelFor(m_files, [&] (size_t f) {
+    std::shared_ptr<Name> next = nullptr;
+
+    for (uint32_t m = manifestCount; m-- > 0;) {
+      auto begin = packetNames.begin() + f * m_unitsPerFile;
+      std::vector<Name> catalog(begin + m * m_namesPerManifest,
+                                begin + std::min(m_unitsPerFile, (m + 1) * m_namesPerManifest));
+
+      ndn_ntorrent::FileManifest manifest(Name(getFileName(f)).appendSequenceNumber(m),
+                                          m_payloadSize, m_prefix, catalog, next);
+      manifest.finalize();
+      setFakeSignature(manifest, m_signatureValue, m_keyLocator);
+      next = std::make_shared<Name>(manifest.getFullName());
+      fileManifests[f].push_back(manifest);
+    }
+
+    initialManifests[f] = *next;
+  }, m_threads);
+
+  for (const auto& chain : fileManifests)
+    content.manifests.insert(content.manifests.end(), chain.rbegin(), chain.rend());
+
+  //The torrent file only lists the initial manifest of every file
+  uint32_t segmentCount = (initialManifests.size() + m_namesPerSegment - 1) / m_namesPerSegment;
+  std::vector<ndn_ntorrent::TorrentFile> segments;
+  Name next;
+
+  for (uint32_t s = segmentCount; s-- > 0;) {
+    auto begin = initialManifests.begin() + s * m_namesPerSegment;
+    auto end = initialManifests.begin() + std::min<size_t>(initialManifests.size(), (s + 1) * m_namesPerSegment);
+    std::vector<Name> catalog(begin, end);
+    Name segmentName = Name(m_prefix).append("torrent-file").appendSequenceNumber(s);
+
+    if (next.empty())
+      segments.push_back(ndn_ntorrent::TorrentFile(segmentName, m_prefix, catalog));
+    else
+      segments.push_back(ndn_ntorrent::TorrentFile(segmentName, next, m_prefix, catalog));
+
+    segments.back().finalize();
+    setFakeSignature(segments.back(), m_signatureValue, m_keyLocator);
+    next = segments.back().getFullName();
+  }
+
+  content.torrentSegments.assign(segments.rbegin(), segments.rend());
+}
+
+bool
+VirtualTorrent::parseName(const Name& name, uint32_t& file, uint64_t& manifest, uint64_t& unit) const
+{
+  size_t size = name.size();
+  if (size > 0 && name.get(-1).isImplicitSha256Digest())
+    size--;
+
+  if (size != m_prefix.size() + 3 || !m_prefix.isPrefixOf(name))
+    return false;
+
+  std::string fileComponent = name.get(m_prefix.size()).toUri();
+  if (fileComponent.compare(0, FILE_COMPONENT_PREFIX.size(), FILE_COMPONENT_PREFIX) != 0)
+    return false;
+
+  char* fileEnd = nullptr;
+  unsigned long f = std::strtoul(fileComponent.c_str() + FILE_COMPONENT_PREFIX.size(), &fileEnd, 10);
+  const auto& manifestComponent = name.get(size - 2);
+  const auto& unitComponent = name.get(size - 1);
+  if (*fileEnd != '\0' || !manifestComponent.isSequenceNumber() || !unitComponent.isSequenceNumber())
+    return false;
+
+  file = f;
+  manifest = manifestComponent.toSequenceNumber();
+  unit = unitComponent.toSequenceNumber();
+  return f < m_files && unit < m_unitsPerFile && manifest == unit / m_namesPerManifest;
+}
+
+std::shared_ptr<Data>
+VirtualTorrent::makeDataPacket(const Name& name) const
+{
+  uint32_t f;
+  uint64_t m;
+  uint64_t u;
+  if (!parseName(name, f, m, u))
+    return nullptr;
+
+  return makeDataPacket(f, m, u);
+}
+
+bool
+VirtualTorrent::unpackBundle(const Data& bundle, std::vector< ::ndn::Block>& payloads) const
+{
+  uint32_t f;
+  uint64_t m;
+  uint64_t b;
+  if (m_bundleSize == 1 || !parseName(bundle.getName(), f, m, b))
+    return false;
+
+  uint64_t next = b * m_bundleSize;
+  uint64_t end = std::min<uint64_t>(m_packetsPerFile, next + m_bundleSize);
+
+  ::ndn::Block content = bundle.getContent();
+  content.parse();
+  for (::ndn::Block part : content.elements()) {
+    if (part.type() != BUNDLE_PART)
+      return false;
+    part.parse();
+
+    auto index = part.find(BUNDLE_PART_INDEX);
+    auto payload = part.find(BUNDLE_PART_PAYLOAD);
+    if (index == part.elements_end() || payload == part.elements_end() ||
+        ::ndn::readNonNegativeInteger(*index) != next || payload->value_size() != m_payloadSize)
+      return false;
+
+    payloads.push_back(*payload);
+    next++;
+  }
+  return next == end;
+}
+
+std::shared_ptr<Data>
+VirtualTorrent::makeDataPacket(uint32_t file, uint32_t manifest, uint32_t unit) const
+{
+  auto data = std::make_shared<Data>(Name(getFileName(file)).appendSequenceNumber(manifest)
+                                                            .appendSequenceNumber(unit));
+
+  std::vector<uint8_t> payload(m_payloadSize);
+  if (m_bundleSize == 1) {
+    fillPayload(file, unit, payload.data());
+    data->setContent(payload.data(), payload.size());
+  }
+  else {
+    ::ndn::Block content(::ndn::tlv::Content);
+    uint64_t end = std::min<uint64_t>(m_packetsPerFile, uint64_t(unit + 1) * m_bundleSize);
+    for (uint64_t p = uint64_t(unit) * m_bundleSize; p < end; p++) {
+      fillPayload(file, p, payload.data());
+      ::ndn::Block part(BUNDLE_PART);
+      part.push_back(::ndn::makeNonNegativeIntegerBlock(BUNDLE_PART_INDEX, p));
+      part.push_back(::ndn::makeBinaryBlock(BUNDLE_PART_PAYLOAD, payload.data(), payload.size()));
+      part.encode();
+      content.push_back(part);
+    }
+    content.encode();
+    data->setContent(content);
+  }
+
+  setFakeSignature(*data, m_signatureValue, m_keyLocator);
+  return data;
+}
+
+void
+VirtualTorrent::fillPayload(uint32_t file, uint32_t packet, uint8_t* payload) const
+{
+  //xorshift64, seeded by (file, packet)
+  uint64_t state = ((uint64_t(file) << 32) | packet) * 0x9E3779B97F4A7C15ull + 1;
+  for (uint32_t i = 0; i < m_payloadSize; i++) {
+    if (i % 8 == 0) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+    }
+    payload[i] = state >> (8 * (i % 8));
+  }
+}
+
+void
+setFakeSignature(Data& data, uint32_t signatureValue, const Name& keyLocator)
+{
+  ::ndn::Signature signature;
+  ::ndn::SignatureInfo signatureInfo(static_cast< ::ndn::tlv::SignatureTypeValue>(255));
+
+  if (keyLocator.size() > 0) {
+    signatureInfo.setKeyLocator(keyLocator);
+  }
+
+  signature.setInfo(signatureInfo);
+  signature.setValue(::ndn::makeNonNegativeIntegerBlock(::ndn::tlv::SignatureValue, signatureValue));
+
+  data.setSignature(signature);
+  data.wireEncode();
+}
+
+} // namespace ndn
+} // namespace ns3
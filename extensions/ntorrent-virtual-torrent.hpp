@@ -0,0 +1,182 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#ifndef NTORRENT_VIRTUAL_TORRENT_HPP
+#define NTORRENT_VIRTUAL_TORRENT_HPP
+
+#include <ndn-cxx/data.hpp>
+#include <ndn-cxx/encoding/block.hpp>
+
+#include <memory>
+#include <vector>
+
+#include "src/torrent-file.hpp"
+#include "src/file-manifest.hpp"
+
+namespace ndn_ntorrent = ndn::ntorrent;
+
+namespace ns3 {
+namespace ndn {
+
+using ::ndn::Data;
+using ::ndn::Name;
+
+/*
+ * @brief Synthetic torrent whose data packets are never stored.
+ *
+ * The torrent has `files` files of `packetsPerFile` packets with `payloadSize` bytes each.
+ * Packet payloads come from a deterministic generator seeded by (file, packet), so a packet
+ * synthesized when its Interest arrives is byte for byte the packet that was hashed into
+ * the manifest catalog, and every node generating the same torrent gets the same names.
+ *
+ * Names (<prefix> is /NTORRENT/virtual):
+ *
+ *   torrent file segment   <prefix>/torrent-file/<seq>
+ *   file manifest          <prefix>/file-<f>/<manifest seq>
+ *   data packet            <prefix>/file-<f>/<manifest seq>/<packet seq>
+ *
+ * With bundleSize K > 1, catalogs list bundles instead of packets: bundle <b> of a file carries
+ * packets [b*K, (b+1)*K) in its content, each as a BUNDLE_PART TLV holding the packet index and
+ * its payload. Bundles are named like data packets (<packet seq> becomes <bundle seq>), so
+ * only 1/K as many Interests and Data cross the network for the same bytes.
+ *
+ * Memory is O(manifests): generate() hashes every packet once and keeps only its name.
+ * Every packet carries a fake signature (signatureValue, keyLocator), applied once when the
+ * packet is built; it is part of the digests, so all nodes must use the same values.
+ *
+ * Hashing is spread over `threads` threads (0: every core), and the result is kept for the
+ * lifetime of the process, so every app asking for the same torrent shares one generation.
+ */
+class VirtualTorrent
+{
+public:
+  //Application range TLV types of bundle contents
+  enum {
+    BUNDLE_PART = 200,
+    BUNDLE_PART_INDEX = 201,
+    BUNDLE_PART_PAYLOAD = 202
+  };
+
+  VirtualTorrent(uint32_t files, uint32_t packetsPerFile, uint32_t payloadSize,
+                 uint32_t namesPerSegment, uint32_t namesPerManifest, uint32_t bundleSize = 1,
+                 uint32_t signatureValue = 0, const Name& keyLocator = Name(), uint32_t threads = 0);
+
+  /*
+   * @brief Build the torrent file segments and all file manifests, in the same order
+   *        TorrentFile::generate returns them.
+   */
+  void
+  generate(std::vector<ndn_ntorrent::TorrentFile>& torrentSegments,
+           std::vector<ndn_ntorrent::FileManifest>& manifests) const;
+
+  //First torrent file segment, the only one a consumer starts with
+  ndn_ntorrent::TorrentFile
+  getInitialSegment() const;
+
+  //Same as generate(), without copying
+  const std::vector<ndn_ntorrent::TorrentFile>&
+  getTorrentSegments() const
+  {
+    return getContent().torrentSegments;
+  }
+
+  const std::vector<ndn_ntorrent::FileManifest>&
+  getManifests() const
+  {
+    return getContent().manifests;
+  }
+
+  /*
+   * @brief Synthesize the data packet with this name (with or without implicit digest)
+   * @return nullptr if the name is not a data packet of this torrent
+   */
+  std::shared_ptr<Data>
+  makeDataPacket(const Name& name) const;
+
+  /*
+   * @brief Check the parts of a bundle (indexes in sequence, payload sizes) and extract their payloads
+   * @return false if bundle is not a well formed bundle of this torrent
+   */
+  bool
+  unpackBundle(const Data& bundle, std::vector< ::ndn::Block>& payloads) const;
+
+  uint32_t
+  getBundleSize() const
+  {
+    return m_bundleSize;
+  }
+
+  const Name&
+  getPrefix() const
+  {
+    return m_prefix;
+  }
+
+private:
+  struct Content
+  {
+    std::vector<ndn_ntorrent::TorrentFile> torrentSegments;
+    std::vector<ndn_ntorrent::FileManifest> manifests;
+  };
+
+  const Content&
+  getContent() const;
+
+  void
+  build(Content& content) const;
+
+  //Parse <prefix>/file-<f>/<manifest seq>/<unit seq>[/<digest>]; a unit is a packet or a bundle
+  bool
+  parseName(const Name& name, uint32_t& file, uint64_t& manifest, uint64_t& unit) const;
+
+  std::shared_ptr<Data>
+  makeDataPacket(uint32_t file, uint32_t manifest, uint32_t unit) const;
+
+  void
+  fillPayload(uint32_t file, uint32_t packet, uint8_t* payload) const;
+
+  Name
+  getFileName(uint32_t file) const;
+
+private:
+  Name m_prefix;
+  uint32_t m_files;
+  uint32_t m_packetsPerFile;
+  uint32_t m_payloadSize;
+  uint32_t m_namesPerSegment;
+  uint32_t m_namesPerManifest;
+  uint32_t m_bundleSize;
+  //Catalog entries per file: packets, or bundles of m_bundleSize packets
+  uint32_t m_unitsPerFile;
+  uint32_t m_signatureValue;
+  Name m_keyLocator;
+  uint32_t m_threads;
+};
+
+/*
+ * @brief Sign with a fake signature (as ndnSIM's Producer does): no crypto, deterministic
+ */
+void
+setFakeSignature(Data& data, uint32_t signatureValue = 0, const Name& keyLocator = Name());
+
+} // namespace ndn
+} // namespace ns3
+
+#endif // NTORRENT_VIRTUAL_TORRENT_HPP
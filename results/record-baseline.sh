@@ -0,0 +1,28 @@
+#!/bin/sh
+#
+# Record results/<name>.baseline from a clean optimized build of <commit>, e.g. the tree the
+# swarm benchmark was added on, so later builds can be compared with --compare=<name>.
+#
+#     results/record-baseline.sh cce5241 pre-series
+#
+set -e
+
+commit=${1:?usage: record-baseline.sh <commit> <name>}
+name=${2:?usage: record-baseline.sh <commit> <name>}
+
+top=$(git rev-parse --show-toplevel)
+sha=$(git -C "$top" rev-parse "$commit")
+tree=$(mktemp -d)
+trap 'git -C "$top" worktree remove --force "$tree"' EXIT
+
+git -C "$top" worktree add --detach "$tree" "$sha"
+git -C "$tree" submodule update --init
+
+cd "$tree"
+./waf configure -d optimized
+./waf
+./build/ntorrent-swarm-bench --save="$name" --results="$top/results"
+
+# The benchmark records command, host and date; the commit is only known here
+sed -i "1i # commit: $sha" "$top/results/$name.baseline"
+cat "$top/results/$name.baseline"
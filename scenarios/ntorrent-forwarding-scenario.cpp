@@ -69,6 +69,7 @@ main(int argc, char *argv[])
   // Choosing forwarding strategy
   //StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/multicast");
   StrategyChoiceHelper::Install<nfd_fw::NTorrentStrategy>(nodes, "/");
+  assignStrategyStreams(nodes);
 
   GlobalRoutingHelper ndnGlobalRoutingHelper;
   ndnGlobalRoutingHelper.InstallAll();
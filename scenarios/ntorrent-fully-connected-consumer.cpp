@@ -79,6 +79,7 @@ main(int argc, char *argv[])
   // Choosing forwarding strategy
   //StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/multicast");
   StrategyChoiceHelper::Install<nfd_fw::NTorrentStrategy>(nodes, "/");
+  assignStrategyStreams(nodes);
 
   GlobalRoutingHelper ndnGlobalRoutingHelper;
   ndnGlobalRoutingHelper.InstallAll();
@@ -95,12 +96,12 @@ main(int argc, char *argv[])
       createAndInstall(c1, namesPerSegment, namesPerManifest, dataPacketSize, "consumer", nodes.Get(nodeCount - i), 3.0 + i*1);
   }*/
   
-  //Random time
-  //srand(time(NULL));
+  //Random time (change with --RngRun)
+  Ptr<UniformRandomVariable> startTimes = createScenarioRandom();
   for(int i=1; i<nodeCount; i++)
   {
       ndn::AppHelper c1("NTorrentConsumerApp");
-      float rand_time = 3.0 + rand() % 10;
+      float rand_time = 3.0 + startTimes->GetInteger(0, 9);
       createAndInstall(c1, namesPerSegment, namesPerManifest, dataPacketSize, "consumer", nodes.Get(i), rand_time);
       std::cout << "Node " << i << " starts at " << rand_time << "s" << std::endl;
   }
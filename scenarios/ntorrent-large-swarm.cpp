@@ -0,0 +1,201 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2015 University of California, Los Angeles
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Authors: Akshay Raman <akshay.raman@cs.ucla.edu>
+ */
+
+#include "simulation-common.hpp"
+
+namespace ns3 {
+namespace ndn {
+
+/**
+ * Large swarm that can be split across MPI ranks:
+ *
+ *                  +----------+
+ *                  | producer |
+ *                  +----------+
+ *                       |
+ *     ... -- router(n-1) -- router(0) -- router(1) -- ...     (ring of routers)
+ *                 |            |             |
+ *             consumers    consumers     consumers           (consumersPerRouter each)
+ *
+ * Router r and its consumers live on rank r * ranks / routers, so only the ring links
+ * between two blocks of routers cross ranks. The producer sits next to router 0 (rank 0).
+ * Consumers start at random times between startMin and startMax (change with --RngRun).
+ *
+ * Single process:
+ *
+ *     ./waf --run="ntorrent-large-swarm --routers=100 --consumersPerRouter=10"
+ *
+ * Across 8 local cores (needs NS-3 built with --enable-mpi):
+ *
+ *     ./waf --run="ntorrent-large-swarm --routers=1000 --consumersPerRouter=9" --mpi=8
+ *
+ * Every rank writes its own rate trace (large-swarm.rankN.txt); pass them all to rate-graph.R
+ * to get the aggregated view. Peers' route announcements are exchanged between ranks every
+ * --routeSync seconds; run a single process with the same --routeSync to compare.
+ */
+
+int
+main(int argc, char *argv[])
+{
+  //defaults for command line arguments
+  uint32_t namesPerSegment = 2;
+  uint32_t namesPerManifest = 2;
+  uint32_t dataPacketSize = 64;
+  uint32_t routers = 100;
+  uint32_t consumersPerRouter = 10;
+  double startMin = 2.0;
+  double startMax = 30.0;
+  double stopTime = 120.0;
+  bool mpi = false;
+  double routeSync = 0;
+  bool strategyTrace = false;
+  double memoryTrace = 0;
+  uint32_t virtualFiles = 0;
+  uint32_t virtualPacketsPerFile = 1024;
+  uint32_t payloadSize = 1024;
+  uint32_t bundleSize = 1;
+  double haveInterval = 0;
+  uint64_t storeCapacity = 0;
+  std::string evictionPolicy = "lru";
+  bool torrentCs = false;
+  std::string granularity = "face";
+  std::string traceFile = "large-swarm.txt";
+
+  // Read optional command-line parameters (e.g., enable visualizer with ./waf --run=<> --visualize
+  CommandLine cmd;
+  cmd.AddValue("namesPerSegment", "Number of names per segment", namesPerSegment);
+  cmd.AddValue("namesPerManifest", "Number of names per manifest", namesPerManifest);
+  cmd.AddValue("dataPacketSize", "Data Packet size", dataPacketSize);
+  cmd.AddValue("routers", "Number of routers in the ring", routers);
+  cmd.AddValue("consumersPerRouter", "Number of consumers attached to each router", consumersPerRouter);
+  cmd.AddValue("startMin", "Earliest consumer start time (s)", startMin);
+  cmd.AddValue("startMax", "Latest consumer start time (s)", startMax);
+  cmd.AddValue("stopTime", "Simulation stop time (s)", stopTime);
+  cmd.AddValue("traceFile", "Rate trace file (suffixed with the rank in MPI runs)", traceFile);
+  cmd.AddValue("virtualFiles", "Seed a synthetic torrent with this many files (0: use DUMMY_FILE_PATH)", virtualFiles);
+  cmd.AddValue("virtualPacketsPerFile", "Packets per synthetic file", virtualPacketsPerFile);
+  cmd.AddValue("payloadSize", "Payload size of the synthetic packets", payloadSize);
+  cmd.AddValue("bundleSize", "Synthetic packets carried by each Data (virtual torrents only)", bundleSize);
+  cmd.AddValue("haveInterval", "Period (s) of the consumers' have map advertisements, 0 disables them", haveInterval);
+  cmd.AddValue("storeCapacity", "Bytes of data packets each consumer keeps for seeding, 0 keeps everything", storeCapacity);
+  cmd.AddValue("evictionPolicy", "Data packets consumers evict first: lru, lfu or rarest", evictionPolicy);
+  cmd.AddValue("torrentCs", "Routers use the torrent-aware Content Store policy instead of LRU", torrentCs);
+  cmd.AddValue("granularity", "Strategy delay statistics kept per face, torrent, manifest or range", granularity);
+  cmd.AddValue("memoryTrace", "Period (s) of the per-node memory report, 0 disables it", memoryTrace);
+  cmd.AddValue("strategyTrace", "Write the per-packet strategy trace (one file per rank)", strategyTrace);
+  cmd.AddValue("routeSync", "Period (s) at which peers' route announcements are applied and shared between ranks, 0 applies them at once (MPI runs default to 0.1)", routeSync);
+  cmd.AddValue("mpi", "Run with the distributed simulator (set by ./waf --mpi)", mpi);
+  cmd.Parse(argc, argv);
+
+  if (mpi)
+    enableMpi(&argc, &argv);
+
+  uint32_t ranks = getRankCount();
+
+  if (virtualFiles > 0)
+    useVirtualTorrent(virtualFiles, virtualPacketsPerFile, payloadSize, bundleSize);
+  if (haveInterval > 0)
+    Config::SetDefault("NTorrentConsumerApp::HaveInterval", TimeValue(Seconds(haveInterval)));
+  Config::SetDefault("NTorrentConsumerApp::StoreCapacity", IntegerValue(storeCapacity));
+  Config::SetDefault("NTorrentConsumerApp::EvictionPolicy", StringValue(evictionPolicy));
+
+  if (getRank() == 0) {
+    std::cout << "Running with parameters: " << std::endl;
+    std::cout << "namesPerSegment: " << namesPerSegment << std::endl;
+    std::cout << "namesPerManifest: " << namesPerManifest << std::endl;
+    std::cout << "dataPacketSize: " << dataPacketSize << std::endl;
+    std::cout << "nodes: " << 1 + routers * (1 + consumersPerRouter) << " on " << ranks << " rank(s)" << std::endl;
+  }
+
+  // Creating nodes, partitioned by rank, and connecting them
+  RingSwarm swarm = createRingSwarm(routers, consumersPerRouter);
+
+  // Install NDN stack on all nodes
+  StackHelper ndnHelper;
+  ndnHelper.InstallAll();
+  if (torrentCs)
+    useTorrentCsPolicy(swarm.routers);
+
+  // Choosing forwarding strategy
+  StrategyChoiceHelper::Install<nfd_fw::NTorrentStrategy>(NodeContainer::GetGlobal(), "/");
+  assignStrategyStreams(NodeContainer::GetGlobal());
+  if (granularity == "torrent")
+    nfd_fw::NTorrentStrategy::setGranularity(nfd_fw::NTorrentStrategy::TORRENT);
+  else if (granularity == "manifest")
+    nfd_fw::NTorrentStrategy::setGranularity(nfd_fw::NTorrentStrategy::MANIFEST);
+  else if (granularity == "range")
+    nfd_fw::NTorrentStrategy::setGranularity(nfd_fw::NTorrentStrategy::DATA_RANGE);
+  else if (granularity != "face")
+    NS_FATAL_ERROR("Unknown granularity " << granularity);
+
+  std::ofstream strategyOut;
+  if (strategyTrace) {
+    strategyOut.open(rankFileName("large-swarm-strategy.txt").c_str());
+    nfd_fw::NTorrentStrategy::setTraceStream(&strategyOut);
+  }
+  else {
+    nfd_fw::NTorrentStrategy::setTraceStream(nullptr);
+  }
+
+  GlobalRoutingHelper ndnGlobalRoutingHelper;
+  ndnGlobalRoutingHelper.InstallAll();
+
+  // Installing applications (createAndInstall skips nodes owned by other ranks)
+  ndn::AppHelper p1("NTorrentProducerApp");
+  createAndInstall(p1, namesPerSegment, namesPerManifest, dataPacketSize, "producer", swarm.producer, 1.0f);
+
+  // Every rank draws all start times in the same order, so they agree on the schedule
+  Ptr<UniformRandomVariable> startTimes = createScenarioRandom();
+  for (uint32_t r = 0; r < routers; r++) {
+    for (uint32_t c = 0; c < consumersPerRouter; c++) {
+      ndn::AppHelper c1("NTorrentConsumerApp");
+      float startTime = startTimes->GetValue(startMin, startMax);
+      createAndInstall(c1, namesPerSegment, namesPerManifest, dataPacketSize, "consumer", swarm.consumers[r].Get(c), startTime);
+    }
+  }
+
+  // The seeder is announced statically; peers' announcements are shared between ranks every routeSync
+  ndnGlobalRoutingHelper.AddOrigins("/NTORRENT", swarm.producer);
+  GlobalRoutingHelper::CalculateRoutes();
+  if (mpi && routeSync == 0)
+    routeSync = 0.1;
+  if (routeSync > 0)
+    NTorrentRouting::setSyncInterval(Seconds(routeSync));
+
+  ndn::L3RateTracer::Install(localNodes(NodeContainer::GetGlobal()), rankFileName(traceFile), Seconds(1.0));
+  if (memoryTrace > 0)
+    NTorrentMemoryTracer::Install(localNodes(NodeContainer::GetGlobal()), rankFileName("large-swarm-memory.txt"), Seconds(memoryTrace));
+  //Stops every routeSync seconds to share announcements, on every rank at the same times
+  NTorrentRouting::run(Seconds(stopTime));
+  Simulator::Destroy();
+
+  disableMpi();
+
+  return 0;
+}
+
+} // namespace ndn
+} // namespace ns3
+
+int
+main(int argc, char* argv[])
+{
+  return ns3::ndn::main(argc, argv);
+}
@@ -95,6 +95,7 @@ main(int argc, char *argv[])
   //StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/multicast");
   //StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/client-control");
   StrategyChoiceHelper::Install<nfd_fw::NTorrentStrategy>(nodes, "/");
+  assignStrategyStreams(nodes);
 
   GlobalRoutingHelper ndnGlobalRoutingHelper;
   ndnGlobalRoutingHelper.InstallAll();
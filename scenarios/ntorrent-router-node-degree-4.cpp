@@ -35,14 +35,22 @@ main(int argc, char *argv[])
   uint32_t namesPerSegment = 1;
   uint32_t namesPerManifest = 2;
   uint32_t dataPacketSize = 64;
+  uint32_t congestionThreshold = 0;
   
   // Read optional command-line parameters (e.g., enable visualizer with ./waf --run=<> --visualize
   CommandLine cmd;
   cmd.AddValue("namesPerSegment", "Number of names per segment", namesPerSegment);
   cmd.AddValue("namesPerManifest", "Number of names per manifest", namesPerManifest);
   cmd.AddValue("dataPacketSize", "Data Packet size", dataPacketSize);
+  cmd.AddValue("congestionThreshold", "Queue length (packets) over which routers mark Data, 0 disables marking", congestionThreshold);
   cmd.Parse(argc, argv);
 
+  //Routers mark, consumers adapt their window to the marks
+  if (congestionThreshold > 0) {
+    nfd_fw::NTorrentStrategy::setCongestionThreshold(congestionThreshold);
+    Config::SetDefault("NTorrentConsumerApp::CongestionControl", BooleanValue(true));
+  }
+
   std::cout << "Running with parameters: " << std::endl;
   std::cout << "namesPerSegment: " << namesPerSegment << std::endl;
   std::cout << "namesPerManifest: " << namesPerManifest << std::endl;
@@ -98,6 +106,7 @@ main(int argc, char *argv[])
   //StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/multicast");
   //StrategyChoiceHelper::InstallAll("/", "/localhost/nfd/strategy/client-control");
   StrategyChoiceHelper::Install<nfd_fw::NTorrentStrategy>(nodes, "/");
+  assignStrategyStreams(nodes);
 
   GlobalRoutingHelper ndnGlobalRoutingHelper;
   ndnGlobalRoutingHelper.InstallAll();
@@ -22,20 +22,35 @@
 #define INCLUDED_SIMULATION_COMMON_HPP
 
 #include <cmath>
+#include <fstream>
 
 #include "ns3/core-module.h"
 #include "ns3/ndnSIM-module.h"
 #include "ns3/netanim-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
+#ifdef NTORRENT_WITH_MPI
+#include "ns3/mpi-interface.h"
+#endif
 
 #include "../extensions/ntorrent-consumer-app.hpp"
+#include "../extensions/ntorrent-cs-policy.hpp"
 #include "../extensions/ntorrent-producer-app.hpp"
 #include "../extensions/ntorrent-fwd-strategy.hpp"
+#include "../extensions/ntorrent-memory-tracer.hpp"
+#include "../extensions/ntorrent-routing.hpp"
 #include "src/util/shared-constants.hpp"
 
 #define PI 3.14159
 
+//RNG stream layout: the scenario itself draws from SCENARIO_STREAM, node i's apps
+//draw from NODE_STREAM_BASE + i * STREAMS_PER_NODE onwards, and its NTorrentStrategy from
+//the last stream of that range (NODE_STREAM_BASE + (i + 1) * STREAMS_PER_NODE - 1).
+//Pass --RngSeed=<s> --RngRun=<r> on the command line to get a different (but repeatable) run.
+#define SCENARIO_STREAM 0
+#define NODE_STREAM_BASE 1
+#define STREAMS_PER_NODE 4
+
 namespace ndn_ntorrent = ndn::ntorrent;
 namespace ndn{
 namespace ntorrent{
@@ -71,15 +86,146 @@ namespace ndn {
  *
  */
 
+//Pin the random stream of the NTorrentStrategy of every node in the container;
+//call after StrategyChoiceHelper::Install (routers have no apps to do it for them)
+void assignStrategyStreams(NodeContainer nodes)
+{
+  for (auto node = nodes.Begin(); node != nodes.End(); ++node) {
+    Ptr<L3Protocol> l3 = (*node)->GetObject<L3Protocol>();
+    if (l3 == nullptr)
+      continue;
+    nfd_fw::NTorrentStrategy* strategy = dynamic_cast<nfd_fw::NTorrentStrategy*>(
+        &l3->getForwarder()->getStrategyChoice().findEffectiveStrategy(Name("/")));
+    if (strategy != nullptr)
+      strategy->AssignStreams(NODE_STREAM_BASE + ((*node)->GetId() + 1) * STREAMS_PER_NODE - 1);
+  }
+}
+
+//Pin the random streams of all NTorrent apps in the container, starting at stream,
+//and of the strategy of their nodes
+int64_t assignStreams(ApplicationContainer apps, int64_t stream)
+{
+  int64_t used = 0;
+  for (auto it = apps.Begin(); it != apps.End(); ++it) {
+    Ptr<NTorrentConsumerApp> consumer = DynamicCast<NTorrentConsumerApp>(*it);
+    if (consumer != nullptr)
+      used += consumer->AssignStreams(stream + used);
+    assignStrategyStreams(NodeContainer((*it)->GetNode()));
+  }
+  return used;
+}
+
+/*
+ * Distributed (MPI) runs: every rank builds the whole topology, but only simulates the
+ * nodes whose system id equals its rank. Without MPI everything lives on rank 0.
+ */
+
+//Switch to the distributed simulator; call after cmd.Parse() when --mpi=1 was given
+void enableMpi(int* argc, char*** argv)
+{
+#ifdef NTORRENT_WITH_MPI
+  GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+  MpiInterface::Enable(argc, argv);
+#else
+  NS_FATAL_ERROR("NS-3 was built without the mpi module, reconfigure it with --enable-mpi");
+#endif
+}
+
+//Call after Simulator::Destroy()
+void disableMpi()
+{
+#ifdef NTORRENT_WITH_MPI
+  if (MpiInterface::IsEnabled())
+    MpiInterface::Disable();
+#endif
+}
+
+uint32_t getRank()
+{
+#ifdef NTORRENT_WITH_MPI
+  if (MpiInterface::IsEnabled())
+    return MpiInterface::GetSystemId();
+#endif
+  return 0;
+}
+
+uint32_t getRankCount()
+{
+#ifdef NTORRENT_WITH_MPI
+  if (MpiInterface::IsEnabled())
+    return MpiInterface::GetSize();
+#endif
+  return 1;
+}
+
+//True if this rank simulates node n
+bool isLocal(Ptr<Node> n)
+{
+  return n->GetSystemId() == getRank();
+}
+
+//Nodes simulated by this rank
+NodeContainer localNodes(NodeContainer nodes)
+{
+  NodeContainer local;
+  for (auto it = nodes.Begin(); it != nodes.End(); ++it)
+    if (isLocal(*it))
+      local.Add(*it);
+  return local;
+}
+
+//"trace.txt" becomes "trace.rank2.txt" in a distributed run, so ranks don't overwrite each other
+std::string rankFileName(const std::string& file)
+{
+  if (getRankCount() == 1)
+    return file;
+  std::string::size_type dot = file.rfind('.');
+  std::string suffix = ".rank" + std::to_string(getRank());
+  if (dot == std::string::npos)
+    return file + suffix;
+  return file.substr(0, dot) + suffix + file.substr(dot);
+}
+
 void createAndInstall(ndn::AppHelper x, uint32_t namesPerSegment, 
         uint32_t namesPerManifest, uint32_t dataPacketSize, std::string type, 
         Ptr<Node> n, float startTime)
 {
+  //Apps only run on the rank that owns the node
+  if (!isLocal(n))
+    return;
+
   x.SetAttribute("Prefix", StringValue("/"));
   x.SetAttribute("namesPerSegment", IntegerValue(namesPerSegment));
   x.SetAttribute("namesPerManifest", IntegerValue(namesPerManifest));
   x.SetAttribute("dataPacketSize", IntegerValue(dataPacketSize));
-  x.Install(n).Start(Seconds(startTime));
+  ApplicationContainer apps = x.Install(n);
+  apps.Start(Seconds(startTime));
+  assignStreams(apps, NODE_STREAM_BASE + n->GetId() * STREAMS_PER_NODE);
+}
+
+/*
+ * @brief Make all producers and consumers installed afterwards use a synthetic torrent of
+ * files x packetsPerFile packets of payloadSize bytes, instead of the files in DUMMY_FILE_PATH.
+ * Producers synthesize packets on demand, so memory only grows with the number of manifests.
+ * With bundleSize > 1, every Data carries bundleSize packets; real files are never bundled
+ * (their packets come from nTorrent), use a larger dataPacketSize for them instead.
+ */
+void useVirtualTorrent(uint32_t files, uint32_t packetsPerFile, uint32_t payloadSize, uint32_t bundleSize = 1)
+{
+  for (const std::string app : {"NTorrentProducerApp", "NTorrentConsumerApp"}) {
+    Config::SetDefault(app + "::VirtualFiles", IntegerValue(files));
+    Config::SetDefault(app + "::VirtualPacketsPerFile", IntegerValue(packetsPerFile));
+    Config::SetDefault(app + "::PayloadSize", IntegerValue(payloadSize));
+    Config::SetDefault(app + "::BundleSize", IntegerValue(bundleSize));
+  }
+}
+
+//Random variable for scenario-level decisions (e.g. start times), on its own fixed stream
+Ptr<UniformRandomVariable> createScenarioRandom()
+{
+  Ptr<UniformRandomVariable> rand = CreateObject<UniformRandomVariable>();
+  rand->SetStream(SCENARIO_STREAM);
+  return rand;
 }
 
 //Helper functions to create links...
@@ -96,6 +242,64 @@ void createLink(PointToPointHelper p2p, Ptr<Node> n1, Ptr<Node> n2, std::string
     p2p.Install(n1, n2);
 }
 
+/*
+ * @brief Ring of routers, each with consumersPerRouter leaf nodes, and a producer next to router 0:
+ *
+ *     ... -- router(n-1) -- router(0) -- router(1) -- ...
+ *                 |            |    \        |
+ *             consumers  consumers producer consumers
+ *
+ * Router r and its consumers are placed on rank r * ranks / routers, so in a distributed run
+ * only the ring links between two blocks of routers cross ranks. The producer is on rank 0.
+ * Links crossing ranks become remote channels; their delay is the lookahead of the
+ * distributed simulator, so none of the delays may be zero.
+ */
+struct RingSwarm
+{
+  Ptr<Node> producer;
+  NodeContainer routers;
+  std::vector<NodeContainer> consumers;
+};
+
+RingSwarm createRingSwarm(uint32_t routers, uint32_t consumersPerRouter)
+{
+  RingSwarm swarm;
+  uint32_t ranks = getRankCount();
+
+  swarm.producer = CreateObject<Node>(0);
+  swarm.consumers.resize(routers);
+  for (uint32_t r = 0; r < routers; r++) {
+    uint32_t rank = (uint64_t)r * ranks / routers;
+    swarm.routers.Create(1, rank);
+    swarm.consumers[r].Create(consumersPerRouter, rank);
+  }
+
+  PointToPointHelper p2p;
+  createLink(p2p, swarm.producer, swarm.routers.Get(0), "10Mbps", "5ms");
+  for (uint32_t r = 0; r + 1 < routers; r++)
+    createLink(p2p, swarm.routers.Get(r), swarm.routers.Get(r + 1), "10Mbps", "10ms");
+  if (routers > 2)
+    createLink(p2p, swarm.routers.Get(routers - 1), swarm.routers.Get(0), "10Mbps", "10ms");
+  for (uint32_t r = 0; r < routers; r++)
+    for (uint32_t c = 0; c < consumersPerRouter; c++)
+      createLink(p2p, swarm.routers.Get(r), swarm.consumers[r].Get(c), "1Mbps", "5ms");
+
+  return swarm;
+}
+
+/*
+ * @brief Give the nodes (typically the routers) the torrent-aware Content Store policy,
+ * which keeps metadata and popular pieces cached. Call after StackHelper::Install; the CS
+ * size set on the StackHelper is kept.
+ */
+void useTorrentCsPolicy(NodeContainer nodes)
+{
+  for (auto it = nodes.Begin(); it != nodes.End(); ++it) {
+    nfd::Cs& cs = (*it)->GetObject<L3Protocol>()->getForwarder()->getCs();
+    cs.setPolicy(nfd::cs::Policy::create(nfd::cs::NTorrentCsPolicy::POLICY_NAME));
+  }
+}
+
 } //namespace ndn
 } //namespace ns3
 